@@ -0,0 +1,51 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  Copyright 2014 Autodesk, Inc.  All rights reserved.
+//
+//  Use of this software is subject to the terms of the Autodesk license 
+//  agreement provided at the time of installation or download, or which 
+//  otherwise accompanies this software in either electronic or hard copy form.   
+//
+// DESCRIPTION:
+//
+// This file contains the traits class that adapts the geometry core in 
+// AssocFilletGeometry.h to the AcGe points, vectors and intersection 
+// configurations used by AssocFilletConfig.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "gept3d.h"
+#include "gevec3d.h"
+#include "gegbl.h"
+#include "AssocFilletGeometry.h"
+#pragma pack (push, 8)
+
+
+struct AcGeFilletTraits
+{
+    typedef AcGePoint3d       Point;
+    typedef AcGeVector3d      Vector;
+    typedef AcGe::AcGeXConfig Config;
+
+    static Vector difference(const Point& p, const Point& q)   { return p - q; }
+    static Point  translate (const Point& p, const Vector& v)  { return p + v; }
+    static Vector add       (const Vector& u, const Vector& v) { return u + v; }
+    static Vector scale     (double s, const Vector& v)        { return s * v; }
+    static double dot       (const Vector& u, const Vector& v) { return u.dotProduct(v); }
+    static Vector cross     (const Vector& u, const Vector& v) { return u.crossProduct(v); }
+
+    static int crossingType(const Config& config)
+    {
+        switch (config)
+        {
+        case AcGe::kLeftRight:  return 1;
+        case AcGe::kRightLeft:  return 0;
+        case AcGe::kLeftLeft:   
+        case AcGe::kRightRight: return -1;
+        default:                return -2;
+        }
+    }
+};
+
+#pragma pack (pop)
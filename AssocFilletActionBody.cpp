@@ -14,6 +14,7 @@
 //////////////////////////////////////////////////////////////////////////////
 
 #include "StdAfx.h"
+#include <atomic>
 #include "eoktest.h"
 #include "dbobjptr2.h"
 #include "dbproxy.h"
@@ -23,6 +24,7 @@
 #include "AcDbAssocEdgeActionParam.h"
 #include "AcDbAssocObjectActionParam.h"
 #include "AssocFilletActionBody.h"
+#include "AssocFilletArcIndex.h"
 #include "acdbabb.h"   // AcDb::  abbreviations
 #include "adeskabb.h"  // Adesk:: abbreviations
 
@@ -44,6 +46,17 @@ const wchar_t* const kInputEdgeParamName     = L"InputEdge";
 const wchar_t* const kTrimInputEdgeParamName = L"TrimInput";
 const wchar_t* const kRadiusParamName        = L"Radius";
 
+static std::atomic<Adesk::UInt64> sNumSkippedArcWrites(0);
+static std::atomic<Adesk::UInt64> sNumSkippedEdgeWrites(0);
+static std::atomic<Adesk::UInt64> sNumSkippedEvaluations(0);
+
+// Op codes of the partial undo records of the action body
+//
+enum PartialUndoOpCode
+{
+    kSetFilletConfigUndoOpCode = 1,
+};
+
 
 double AssocFilletActionBody::getRadius(AcString& expressionOut) const
 {
@@ -86,10 +99,15 @@ AcDbEdgeRef AssocFilletActionBody::getInputEdge(int index) const
 }
 
 
+static AcGeCurve3d* copyEdgeCurve(const AcDbEdgeRef& edgeRef)
+{
+    return edgeRef.curve() != nullptr ? static_cast<AcGeCurve3d*>(edgeRef.curve()->copy()) : nullptr;
+}
+
+
 AcGeCurve3d* AssocFilletActionBody::getInputCurve(int index) const
 {
-    const AcDbEdgeRef inputEdge = getInputEdge(index);
-    return inputEdge.curve() != nullptr ? static_cast<AcGeCurve3d*>(inputEdge.curve()->copy()) : nullptr;
+    return copyEdgeCurve(getInputEdge(index));
 }
 
 
@@ -105,12 +123,16 @@ ErrorStatus AssocFilletActionBody::setInputEdge(int index, const AcDbEdgeRef& in
 
 AcDbObjectId AssocFilletActionBody::getFilletArcId() const
 {
+    if (mIsFilletArcIdCached)
+        return mFilletArcId;
     if (mFilletArcDepId.isNull())
         return AcDbObjectId::kNull;
     AcDbObjectPointer<AcDbAssocDependency> pArcEntityDep(mFilletArcDepId, kForRead);
     if (!eOkVerify(pArcEntityDep.openStatus()))
         return AcDbObjectId::kNull;
-    return pArcEntityDep->dependentOnObject();
+    mFilletArcId         = pArcEntityDep->dependentOnObject();
+    mIsFilletArcIdCached = true;
+    return mFilletArcId;
 }
 
 
@@ -182,31 +204,17 @@ ErrorStatus AssocFilletActionBody::setTrimInputEdge(int index, bool yesNo, const
 }
     
     
+// The arc is looked up in the index of fillet arcs of its database, that is
+// kept up to date by a database reactor, so that no objects need to be opened
+//
 bool AssocFilletActionBody::isFilletArc(const AcDbObjectId& filletArcId, AcDbObjectId& filletActionIdOut)
 {
     filletActionIdOut.setNull();
-    AcDbAssocObjectPointer<AcDbArc> pArc(filletArcId, kForRead);
-    if (pArc.openStatus() != eOk)
-        return false; // Not an AcDbArc entity
-    
-    AcDbObjectIdArray actionIds;
-    ErrorStatus err = AcDbAssocAction::getActionsDependentOnObject(pArc, false, true, actionIds);
-    if (!eOkVerify(err))
+    if (filletArcId.isNull() || filletArcId.isErased())
         return false;
 
-    for (int i = 0; i < actionIds.length(); i++)
-    {
-        AcDbObjectPointer<AssocFilletActionBody> pFilletActionBody(AcDbAssocAction::actionBody(actionIds[i]), kForRead);
-        if (pFilletActionBody.openStatus() != eOk)
-            continue;
-
-        if (pFilletActionBody->getFilletArcId() == filletArcId)
-        {
-            filletActionIdOut = actionIds[i]; 
-            return true;
-        }
-    }
-    return false; // No AssocFilletActionBody found on the arc
+    filletActionIdOut = AssocFilletArcIndex::getFilletAction(filletArcId);
+    return !filletActionIdOut.isNull();
 }
 
 
@@ -255,7 +263,14 @@ ErrorStatus AssocFilletActionBody::createFilletArcEntity()
     if (!VERIFY(pFilletArcDep->dependentOnObject().isNull()))
         pFilletArcDep->detachFromObject();
 
-    return pFilletArcDep->attachToObject(arcEntityId); 
+    mIsFilletArcIdCached = false;
+    err = pFilletArcDep->attachToObject(arcEntityId); 
+    if (err == eOk)
+    {
+        mFilletArcId         = arcEntityId;
+        mIsFilletArcIdCached = true;
+    }
+    return err;
 }
 
 
@@ -268,7 +283,9 @@ ErrorStatus AssocFilletActionBody::eraseFilletArcEntity()
     AcDbObjectPointer<AcDbAssocDependency> pFilletArcDep(mFilletArcDepId, kForWrite);
     if (pFilletArcDep.openStatus() == eOk)
         pFilletArcDep->erase();
-    mFilletArcDepId = AcDbObjectId::kNull;
+    mFilletArcDepId      = AcDbObjectId::kNull;
+    mFilletArcId         = AcDbObjectId::kNull;
+    mIsFilletArcIdCached = true;
 
     AcDbObjectPointer<AcDbArc> pFilletArc(filletArcId, kForWrite, false, true);
     if (pFilletArc.openStatus() == eOk)
@@ -277,26 +294,91 @@ ErrorStatus AssocFilletActionBody::eraseFilletArcEntity()
 }
 
 
+AssocFilletActionBody::EvaluationContext AssocFilletActionBody::getEvaluationContext() const
+{
+    EvaluationContext context;
+    context.mRadius = getRadius();
+    for (int i = 0; i < 2; i++)
+    {
+        context.mIsTrimInputEdge[i]  = isTrimInputEdge(i);
+        context.mInputEdge[i]        = getInputEdge(i);
+        context.mInputEdgeParamId[i] = paramAtName(kInputEdgeParamName, i);
+    }
+    return context;
+}
+
+
+bool AssocFilletActionBody::getInputFingerprint(const EvaluationContext& context, InputFingerprint& fingerprintOut) const
+{
+    for (int i = 0; i < 2; i++)
+    {
+        const AcGeCurve3d* const pCurve = context.mInputEdge[i].curve();
+        if (pCurve == nullptr || !AssocFilletConfig::getCurveHash(pCurve, fingerprintOut.mCurveHash[i]))
+            return false;
+        fingerprintOut.mEdgeEntity[i]      = context.mInputEdge[i].entity();
+        fingerprintOut.mEdgeSubentId[i]    = context.mInputEdge[i].subentId();
+        fingerprintOut.mIsTrimInputEdge[i] = context.mIsTrimInputEdge[i];
+    }
+    fingerprintOut.mRadius          = context.mRadius;
+    fingerprintOut.mConfigStateHash = mFilletConfig.stateHash();
+    return true;
+}
+
+
 ErrorStatus AssocFilletActionBody::computeNewGeometry(bool updateConfigState, AcGeCurve3d* pInputCurveOut[2], AcGeCircArc3d& filletArcOut) 
 {
     assertReadEnabled();
+
+    // The configuration is updated on a copy, so that undo is only recorded 
+    // if contents of mFilletConfig actually changes
+    //
+    AssocFilletConfig filletConfig = mFilletConfig;
+    const ErrorStatus err = computeNewGeometry(filletConfig, getEvaluationContext(), updateConfigState, pInputCurveOut, filletArcOut);
+    if (updateConfigState)
+        setFilletConfig(filletConfig);
+    return err;
+}
+
+
+void AssocFilletActionBody::setFilletConfig(const AssocFilletConfig& filletConfig)
+{
+    if (!mFilletConfig.hasSameState(filletConfig))
+    {
+        assertWriteEnabled(false/*autoUndo*/);
+
+        AcDbDwgFiler* const pUndoFiler = undoFiler();
+        if (pUndoFiler != nullptr)
+        {
+            pUndoFiler->writeAddress(AssocFilletActionBody::desc());
+            pUndoFiler->writeInt16(kSetFilletConfigUndoOpCode);
+            mFilletConfig.dwgOutChangedFields(pUndoFiler, filletConfig);
+        }
+    }
+
+    // The offset sub-curve hint that is not filed is taken even if the filed data
+    // did not change
+    //
+    mFilletConfig = filletConfig;
+}
+
+
+ErrorStatus AssocFilletActionBody::computeNewGeometry(AssocFilletConfig&       filletConfig, 
+                                                      const EvaluationContext& context,
+                                                      bool                     updateConfigState, 
+                                                      AcGeCurve3d*             pInputCurveOut[2], 
+                                                      AcGeCircArc3d&           filletArcOut) const
+{
     pInputCurveOut[0] = pInputCurveOut[1] = nullptr;
     filletArcOut = AcGeCircArc3d();
 
-    AcGeCurve3d* pCurve[2] = { getInputCurve(0), getInputCurve(1), };
+    AcGeCurve3d* pCurve[2] = { copyEdgeCurve(context.mInputEdge[0]), copyEdgeCurve(context.mInputEdge[1]), };
     std::auto_ptr<AcGeCurve3d> delete0(pCurve[0]);
     std::auto_ptr<AcGeCurve3d> delete1(pCurve[1]);
     if (!VERIFY(pCurve[0] != nullptr && pCurve[1] != nullptr))
         return eNullPtr;
-    const bool isTrimInput[2] = { isTrimInputEdge(0), isTrimInputEdge(1), };
-
-    // If contents of mFilletConfig is going to change, we need to do undo recording
-    //
-    if (updateConfigState)
-        assertWriteEnabled();
 
     AcGeCircArc3d filletArc;
-    ErrorStatus err = mFilletConfig.evaluate(updateConfigState, pCurve, getRadius(), isTrimInput, true/*adjustTweakedCurves*/, filletArc);
+    ErrorStatus err = filletConfig.evaluate(updateConfigState, pCurve, context.mRadius, context.mIsTrimInputEdge, true/*adjustTweakedCurves*/, filletArc);
     if (err == eOk)
     {
         pInputCurveOut[0] = pCurve[0];
@@ -307,7 +389,7 @@ ErrorStatus AssocFilletActionBody::computeNewGeometry(bool updateConfigState, Ac
         // If radius is 0.0, filletArc has center at the intersection, but 
         // we want to return a null arc that the caller expects in this case
         //
-        if (getRadius() != 0.0) 
+        if (context.mRadius != 0.0) 
             filletArcOut = filletArc;
     }
     return err;
@@ -330,20 +412,22 @@ void AssocFilletActionBody::evaluateOverride()
     if (pEvalCallback->evaluationMode() == kModifyActionAssocEvaluationMode)
     {
         // If the action is not satisfied, i.e. its evaluation would produce different
-        // geometry than the current one, request the action to be erased
+        // geometry than the current one, request the action to be erased. The input
+        // edges of erased or broken dependencies cannot be obtained, so they are 
+        // checked before the evaluation context is obtained
         //
-        if (doesActionMatchCurrentGeometry())
+        AssocFilletConfig updatedFilletConfig;
+        if (!hasAnyErasedOrBrokenDependencies() && 
+            doesActionMatchCurrentGeometry(getEvaluationContext(), updatedFilletConfig))
         {
             setStatus(kIsUpToDateAssocStatus);
 
             // mFilletConfig needs to be updated. For example, after copy the referenced
-            // geometries have been transformed, but contents of mFilletConfig has not 
+            // geometries have been transformed, but contents of mFilletConfig has not.
+            // The check above has already evaluated the action with the current
+            // inputs, so its updated configuration is taken instead of evaluating again
             //
-            AcGeCurve3d* pNewInputCurveUnused[2] = { nullptr, nullptr, }; 
-            AcGeCircArc3d newFilletArcUnused;                            
-            computeNewGeometry(true/*updateConfigState*/, pNewInputCurveUnused, newFilletArcUnused);
-            delete pNewInputCurveUnused[0];
-            delete pNewInputCurveUnused[1];
+            setFilletConfig(updatedFilletConfig);
         }
         else
         {
@@ -365,38 +449,100 @@ void AssocFilletActionBody::evaluateOverride()
 
     evaluateDependencies();
 
+    // The action parameters are obtained after the dependencies have been evaluated
+    //
+    const EvaluationContext context = getEvaluationContext();
+
+    // If the input curves, the radius and mFilletConfig are the same as at the end 
+    // of the last successful evaluation, e.g. when an unrelated dependency triggered
+    // the evaluation, the fillet arc is up to date and only the input edges whose
+    // trim flag has been turned on since then need to be trimmed. The fingerprint
+    // is not used while dragging, because then the arc and the edges are modified 
+    // as temporary clones, not the database-resident entities
+    //
+    InputFingerprint inputFingerprint;
+    bool haveInputFingerprint = pEvalCallback->draggingState() == kNotDraggingAssocDraggingState &&
+                                getInputFingerprint(context, inputFingerprint);
+
+    const bool isFilletInputUnchanged = haveInputFingerprint && mHaveLastInputFingerprint                            &&
+                                        inputFingerprint.mEdgeEntity[0]   == mLastInputFingerprint.mEdgeEntity[0]   &&
+                                        inputFingerprint.mEdgeEntity[1]   == mLastInputFingerprint.mEdgeEntity[1]   &&
+                                        inputFingerprint.mEdgeSubentId[0] == mLastInputFingerprint.mEdgeSubentId[0] &&
+                                        inputFingerprint.mEdgeSubentId[1] == mLastInputFingerprint.mEdgeSubentId[1] &&
+                                        inputFingerprint.mCurveHash[0]    == mLastInputFingerprint.mCurveHash[0]    &&
+                                        inputFingerprint.mCurveHash[1]    == mLastInputFingerprint.mCurveHash[1]    &&
+                                        inputFingerprint.mRadius          == mLastInputFingerprint.mRadius          &&
+                                        inputFingerprint.mConfigStateHash == mLastInputFingerprint.mConfigStateHash;
+    mHaveLastInputFingerprint = false; // Set again if this evaluation succeeds
+
+    bool isTrimNeeded[2] = { context.mIsTrimInputEdge[0], context.mIsTrimInputEdge[1], };
+
     AcGeCurve3d* pNewInputCurve[2] = { nullptr, nullptr, };
     AcGeCircArc3d newFilletArc;
-    ErrorStatus err = computeNewGeometry(true/*updateConfigState*/, pNewInputCurve, newFilletArc);
+    ErrorStatus err = eOk;
+
+    if (isFilletInputUnchanged)
+    {
+        sNumSkippedEvaluations.fetch_add(1, std::memory_order_relaxed);
+        for (int i = 0; i < 2; i++)
+        {
+            isTrimNeeded[i] = context.mIsTrimInputEdge[i] && !mLastInputFingerprint.mIsTrimInputEdge[i];
+            if (isTrimNeeded[i])
+                pNewInputCurve[i] = copyEdgeCurve(context.mInputEdge[i]);
+        }
+        err = mFilletConfig.trimToLastFilletArc(pNewInputCurve, isTrimNeeded);
+    }
+    else
+    {
+        // The configuration is updated on a copy, so that undo is only recorded 
+        // if contents of mFilletConfig actually changes
+        //
+        AssocFilletConfig updatedFilletConfig = mFilletConfig;
+        err = computeNewGeometry(updatedFilletConfig, context, true/*updateConfigState*/, pNewInputCurve, newFilletArc);
+        setFilletConfig(updatedFilletConfig);
+    }
 
     std::auto_ptr<AcGeCurve3d> delete0(pNewInputCurve[0]);
     std::auto_ptr<AcGeCurve3d> delete1(pNewInputCurve[1]);
     if (err != eOk)
         goto Done;
 
-    // Change the fillet AcDbArc, or erase it if the fillet radius is 0.0
+    // Change the fillet AcDbArc, or erase it if the fillet radius is 0.0.
     //
-    if (getRadius() > 0.0)
+    // The arc and the input edges are only written if their geometry changed, 
+    // because every write marks the entity modified, records undo, and makes 
+    // the actions that depend on the entity evaluate again
+    //
+    if (context.mRadius > 0.0)
     {
-        if (getFilletArcId().isNull())
+        bool isFilletArcUpToDate = isFilletInputUnchanged; // Then the last evaluation has set the arc
+        if (!isFilletArcUpToDate && getFilletArcId().isNull())
         {
             createFilletArcEntity();
         }
+        else if (!isFilletArcUpToDate && getFilletArcGeom().isEqualTo(newFilletArc, AssocFilletConfig::geomTolerance()))
+        {
+            isFilletArcUpToDate = true;
+            sNumSkippedArcWrites.fetch_add(1, std::memory_order_relaxed);
+        }
 
-        // Notice that we are using AcDbAssocObjectPointer, not AcDb(Smart)ObjectPointer.
-        // During dragging, it returns a temporary non-database-resident clone of 
-        // the original entity, instead of the original database-resident entity.
-        // The clone is then modified by our code and drawn by the dragger. 
-        // The database-resident entity is only modified at the end of the 
-        // dragging, on the last drag sample
-        //
-        AcDbAssocObjectPointer<AcDbArc> pFilletArc(getFilletArcId(), kForWrite);
-        if (!eOkVerify(err = pFilletArc.openStatus())) // E.g. the arc entity is on a locked layer
-            goto Done;
-        if (!eOkVerify(err = pFilletArc->setFromAcGeCurve(newFilletArc)))
-            goto Done;
+        if (!isFilletArcUpToDate)
+        {
+            // Notice that we are using AcDbAssocObjectPointer, not AcDb(Smart)ObjectPointer.
+            // During dragging, it returns a temporary non-database-resident clone of 
+            // the original entity, instead of the original database-resident entity.
+            // The clone is then modified by our code and drawn by the dragger. 
+            // The database-resident entity is only modified at the end of the 
+            // dragging, on the last drag sample
+            //
+            AcDbAssocObjectPointer<AcDbArc> pFilletArc(getFilletArcId(), kForWrite);
+            if (!eOkVerify(err = pFilletArc.openStatus())) // E.g. the arc entity is on a locked layer
+                goto Done;
+            if (!eOkVerify(err = pFilletArc->setFromAcGeCurve(newFilletArc)))
+                goto Done;
+        }
     }
-    else // radius == 0.0, no fillet arc
+    else if (!isFilletInputUnchanged) // radius == 0.0, no fillet arc
     {
         eraseFilletArcEntity();
     }
@@ -405,9 +551,17 @@ void AssocFilletActionBody::evaluateOverride()
     //
     for (int i = 0; i < 2; i++)
     {
-        if (isTrimInputEdge(i))
+        if (isTrimNeeded[i])
         {
-            AcDbObjectPointer<AcDbAssocEdgeActionParam> pInputEdgeParam(paramAtName(kInputEdgeParamName, i), kForWrite);
+            const AcGeCurve3d* const pCurrentInputCurve = context.mInputEdge[i].curve();
+            if (pCurrentInputCurve != nullptr && 
+                pCurrentInputCurve->isEqualTo(*pNewInputCurve[i], AssocFilletConfig::geomTolerance()))
+            {
+                sNumSkippedEdgeWrites.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+
+            AcDbObjectPointer<AcDbAssocEdgeActionParam> pInputEdgeParam(context.mInputEdgeParamId[i], kForWrite);
             if (eOkVerify(pInputEdgeParam.openStatus()))
             {
                 // Notice that setEdgeSubentityGeometry() uses AcDbAssocObjectPointer 
@@ -417,6 +571,15 @@ void AssocFilletActionBody::evaluateOverride()
                 //
                 if (!eOkVerify(err = pInputEdgeParam->setEdgeSubentityGeometry(pNewInputCurve[i])))
                     goto Done;
+
+                // The next evaluation gets the edge with the geometry just set
+                //
+                if (haveInputFingerprint)
+                    haveInputFingerprint = AssocFilletConfig::getCurveHash(pNewInputCurve[i], inputFingerprint.mCurveHash[i]);
+            }
+            else
+            {
+                haveInputFingerprint = false; // The edge is not trimmed, the next evaluation tries again
             }
         }
     }
@@ -425,6 +588,13 @@ Done:
     if (err == eOk)
     {
         setStatus(kIsUpToDateAssocStatus);
+
+        if (haveInputFingerprint)
+        {
+            inputFingerprint.mConfigStateHash = mFilletConfig.stateHash();
+            mLastInputFingerprint     = inputFingerprint;
+            mHaveLastInputFingerprint = true;
+        }
     }
     else
     {
@@ -477,10 +647,15 @@ static AcDbObjectId getBtrOfEntity(const AcDbObjectId entityId)
 //
 ErrorStatus AssocFilletActionBody::postProcessAfterDeepCloneOverride(AcDbIdMapping& idMap)
 {
-    if (getFilletArcId().isNull())
+    // The ids have been translated, the dependency may now reference the cloned arc
+    //
+    mIsFilletArcIdCached = false;
+
+    const AcDbObjectId filletArcId = getFilletArcId();
+    if (filletArcId.isNull())
         return eOk; // 0.0 radius fillet. no fillet AcDbArc
 
-    const AcDbObjectId clonedArcId          = mapId(idMap, getFilletArcId());
+    const AcDbObjectId clonedArcId          = mapId(idMap, filletArcId);
     const AcDbObjectId clonedInputEdgeId    = mapId(idMap, getInputEdge(0).entity().topId());
     const AcDbObjectId clonedInputEdgeBTRId = getBtrOfEntity(clonedInputEdgeId);
 
@@ -500,29 +675,67 @@ ErrorStatus AssocFilletActionBody::postProcessAfterDeepCloneOverride(AcDbIdMappi
 bool AssocFilletActionBody::doesActionMatchCurrentGeometry() const
 {
     if (hasAnyErasedOrBrokenDependencies())
-        return false;
+        return false; // Checked before the input edges are obtained for the context
+
+    AssocFilletConfig updatedFilletConfigUnused;
+    return doesActionMatchCurrentGeometry(getEvaluationContext(), updatedFilletConfigUnused);
+}
+
+
+void AssocFilletActionBody::getSkippedWriteStatistics(Adesk::UInt64& numSkippedArcWrites, Adesk::UInt64& numSkippedEdgeWrites)
+{
+    numSkippedArcWrites  = sNumSkippedArcWrites;
+    numSkippedEdgeWrites = sNumSkippedEdgeWrites;
+}
+
+
+void AssocFilletActionBody::resetSkippedWriteStatistics()
+{
+    sNumSkippedArcWrites  = 0;
+    sNumSkippedEdgeWrites = 0;
+}
+
+
+Adesk::UInt64 AssocFilletActionBody::numSkippedEvaluations()
+{
+    return sNumSkippedEvaluations;
+}
+
+
+void AssocFilletActionBody::resetNumSkippedEvaluations()
+{
+    sNumSkippedEvaluations = 0;
+}
+
+
+// The action is evaluated on a copy of mFilletConfig, so mFilletConfig does not
+// change and the copy ends up in the state the evaluation would leave it in
+//
+bool AssocFilletActionBody::doesActionMatchCurrentGeometry(const EvaluationContext& context, AssocFilletConfig& updatedFilletConfig) const
+{
+    updatedFilletConfig = mFilletConfig;
 
     AcGeCurve3d* pNewInputCurve[2] = { nullptr, nullptr, };
     AcGeCircArc3d newFilletArc;
-    if (const_cast<AssocFilletActionBody*>(this)->computeNewGeometry(false/*updateConfigState*/, pNewInputCurve, newFilletArc) != eOk)
+    if (computeNewGeometry(updatedFilletConfig, context, true/*updateConfigState*/, pNewInputCurve, newFilletArc) != eOk)
         return false;
     std::auto_ptr<AcGeCurve3d> delete0(pNewInputCurve[0]);
     std::auto_ptr<AcGeCurve3d> delete1(pNewInputCurve[1]);
     if (pNewInputCurve[0] == nullptr || pNewInputCurve[1] == nullptr)
         return false;
 
-    const AcGeCurve3d* pCurrentInputCurve[2] = { getInputCurve(0), getInputCurve(1), };
+    const AcGeCurve3d* pCurrentInputCurve[2] = { copyEdgeCurve(context.mInputEdge[0]), copyEdgeCurve(context.mInputEdge[1]), };
     const AcGeCircArc3d currentFilletArc = getFilletArcGeom();
     std::auto_ptr<const AcGeCurve3d> delete2(pCurrentInputCurve[0]);
     std::auto_ptr<const AcGeCurve3d> delete3(pCurrentInputCurve[1]);
     if (pCurrentInputCurve[0] == nullptr || pCurrentInputCurve[1] == nullptr)
         return false;
 
-    AcGeTolSetter relaxedTol;
+    const AcGeTol tol = AssocFilletConfig::geomTolerance();
 
-    return currentFilletArc.isEqualTo(newFilletArc)             &&
-           pCurrentInputCurve[0]->isEqualTo(*pNewInputCurve[0]) && 
-           pCurrentInputCurve[1]->isEqualTo(*pNewInputCurve[1]);
+    return currentFilletArc.isEqualTo(newFilletArc, tol)             &&
+           pCurrentInputCurve[0]->isEqualTo(*pNewInputCurve[0], tol) && 
+           pCurrentInputCurve[1]->isEqualTo(*pNewInputCurve[1], tol);
 }
 
 
@@ -645,6 +858,8 @@ ErrorStatus AssocFilletActionBody::dwgOutFields(AcDbDwgFiler* pFiler) const
 
 ErrorStatus AssocFilletActionBody::dwgInFields(AcDbDwgFiler* pFiler)
 {
+    mIsFilletArcIdCached = false;
+
     const ErrorStatus err = AcDbAssocActionBody::dwgInFields(pFiler);
     if (!eOkVerify(err))
         return err;
@@ -693,6 +908,8 @@ ErrorStatus AssocFilletActionBody::dxfOutFields(AcDbDxfFiler* pFiler) const
 
 ErrorStatus AssocFilletActionBody::dxfInFields(AcDbDxfFiler* pFiler)
 {
+    mIsFilletArcIdCached = false;
+
     ErrorStatus err = AcDbAssocActionBody::dxfInFields(pFiler);
     if (!eOkVerify(err))
         return err;
@@ -735,3 +952,28 @@ ErrorStatus AssocFilletActionBody::dxfInFields(AcDbDxfFiler* pFiler)
 
     return mFilletConfig.dxfInFields(pFiler);
 }
+
+
+ErrorStatus AssocFilletActionBody::applyPartialUndo(AcDbDwgFiler* pUndoFiler, AcRxClass* pClass)
+{
+    if (pClass != AssocFilletActionBody::desc())
+        return AcDbAssocActionBody::applyPartialUndo(pUndoFiler, pClass);
+
+    Int16 undoOpCode = 0;
+    pUndoFiler->readInt16(&undoOpCode);
+    if (undoOpCode != kSetFilletConfigUndoOpCode)
+    {
+        ASSERT(!"Unknown partial undo op code");
+        return eInvalidInput;
+    }
+
+    // Setting the configuration records the data it changes, so that the undo
+    // can be redone
+    //
+    AssocFilletConfig filletConfig = mFilletConfig;
+    const ErrorStatus err = filletConfig.dwgInChangedFields(pUndoFiler);
+    if (!eOkVerify(err))
+        return err;
+    setFilletConfig(filletConfig);
+    return eOk;
+}
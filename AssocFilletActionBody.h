@@ -43,7 +43,7 @@ class AssocFilletActionBody : public AcDbAssocActionBody
 public:
     ACRX_DECLARE_MEMBERS(AssocFilletActionBody);
 
-    AssocFilletActionBody() {}
+    AssocFilletActionBody() : mIsFilletArcIdCached(false), mHaveLastInputFingerprint(false) {}
     virtual ~AssocFilletActionBody() {}
 
     //////////////////////////////////////////////////////////////////////////
@@ -90,7 +90,8 @@ public:
 
     // Utility predicate to check whether the entity is an AcDbArc and is controlled 
     // by an associative fillet action. If yes returns true and the AcDbObjectId of
-    // the fillet action
+    // the fillet action. Use AssocFilletArcIndex::getFilletActions() to check all
+    // the entities of a selection set in one pass
     //
     static bool isFilletArc(const AcDbObjectId& filletArcId, AcDbObjectId& filletActionIdOut);
 
@@ -107,6 +108,20 @@ public:
     //
     bool doesActionMatchCurrentGeometry() const;
 
+    // Number of writes of the fillet arc and of the trimmed input edges that the
+    // evaluation skipped, because the new geometry was equal to the current one 
+    // within the tolerance. The skipped writes do not mark the entities modified,
+    // so the actions that depend on them are not evaluated again
+    //
+    static void getSkippedWriteStatistics(Adesk::UInt64& numSkippedArcWrites, Adesk::UInt64& numSkippedEdgeWrites);
+    static void resetSkippedWriteStatistics();
+
+    // Number of evaluations that found the inputs unchanged since the last successful
+    // evaluation and did not calculate the fillet arc again
+    //
+    static Adesk::UInt64 numSkippedEvaluations();
+    static void          resetNumSkippedEvaluations();
+
     // Pseudo-constructor:
     // - Creates AcDbAssocAction, AssocFilletActionBody, and AcDbArc fillet entity 
     // - Adds them to the database of the first input edge
@@ -161,7 +176,65 @@ public:
     virtual Acad::ErrorStatus dxfOutFields(AcDbDxfFiler*) const override;     
     virtual Acad::ErrorStatus dxfInFields (AcDbDxfFiler*) override;
 
+    // Undoes the change of mFilletConfig recorded by setFilletConfig()
+    //
+    virtual Acad::ErrorStatus applyPartialUndo(AcDbDwgFiler*, AcRxClass*) override;
+
 private:
+    // Values of the action parameters that one evaluation of the action needs, 
+    // obtained once at its beginning, so that the action parameters are not 
+    // opened and their expressions are not evaluated again at every step
+    //
+    struct EvaluationContext
+    {
+        double       mRadius;
+        bool         mIsTrimInputEdge[2];
+        AcDbEdgeRef  mInputEdge[2];
+        AcDbObjectId mInputEdgeParamId[2];
+    };
+    EvaluationContext getEvaluationContext() const;
+
+    // Same as computeNewGeometry(), but evaluates the given fillet configuration 
+    // instead of mFilletConfig, with the action parameters from the context
+    //
+    Acad::ErrorStatus computeNewGeometry(AssocFilletConfig&       filletConfig, 
+                                         const EvaluationContext& context,
+                                         bool                     updateConfigState, 
+                                         AcGeCurve3d*             pInputCurveOut[2], 
+                                         AcGeCircArc3d&           filletArcOut) const;
+
+    // Same as doesActionMatchCurrentGeometry(), but also returns the fillet 
+    // configuration updated by the evaluation, so that the caller can use it 
+    // instead of evaluating the action again to update mFilletConfig. The caller
+    // must have checked that no dependency is erased or broken before getting
+    // the context
+    //
+    bool doesActionMatchCurrentGeometry(const EvaluationContext& context, AssocFilletConfig& updatedFilletConfig) const;
+
+    // Records undo only if the filed data of the fillet configuration change, and 
+    // then only the changed data, not the whole action body
+    //
+    void setFilletConfig(const AssocFilletConfig& filletConfig);
+
+    // Compact fingerprint of the inputs of an evaluation. The curve hashes are
+    // of the input edge geometries, the config hash is of mFilletConfig. The edge
+    // entities and subentities are kept too, so that an edge replaced by another
+    // one with the same geometry does not count as unchanged
+    //
+    struct InputFingerprint
+    {
+        AcDbCompoundObjectId mEdgeEntity[2];
+        AcDbSubentId         mEdgeSubentId[2];
+        Adesk::UInt64        mCurveHash[2];
+        double               mRadius;
+        bool                 mIsTrimInputEdge[2];
+        Adesk::UInt64        mConfigStateHash;
+    };
+
+    // Returns false if the input edge geometries cannot be hashed
+    //
+    bool getInputFingerprint(const EvaluationContext& context, InputFingerprint& fingerprintOut) const;
+
     // Configuration of the intersection point, used for determining 
     // at which intersection among possible multiple intersections to 
     // place the fillet arc, and in which of the four quadrants around
@@ -172,6 +245,21 @@ private:
     // We use an AcDbAssocDependency to reference the fillet AcDbArc entity
     //
     AcDbObjectId mFilletArcDepId; 
+
+    // The AcDbArc the dependency is attached to, so that getFilletArcId() does not
+    // open the dependency every time. It is set when the dependency is attached or
+    // erased, and invalidated when the body is read from a filer (undo, clone) and
+    // after deep clone, when the dependency may have been redirected. Not filed
+    //
+    mutable AcDbObjectId mFilletArcId;
+    mutable bool         mIsFilletArcIdCached;
+
+    // Fingerprint of the inputs at the end of the last successful evaluation, 
+    // i.e. with the input edges already trimmed. It is not filed, so the first
+    // evaluation after the action is loaded or cloned evaluates the fillet
+    //
+    InputFingerprint mLastInputFingerprint;
+    bool             mHaveLastInputFingerprint;
 };
 
 #pragma pack (pop)
@@ -0,0 +1,233 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  Copyright 2014 Autodesk, Inc.  All rights reserved.
+//
+//  Use of this software is subject to the terms of the Autodesk license 
+//  agreement provided at the time of installation or download, or which 
+//  otherwise accompanies this software in either electronic or hard copy form.   
+//
+// DESCRIPTION:
+//
+// This file contains implementation of AssocFilletArcIndex class.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include "StdAfx.h"
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include "eoktest.h"
+#include "dbobjptr2.h"
+#include "AcDbAssocNetwork.h"
+#include "AssocFilletActionBody.h"
+#include "AssocFilletArcIndex.h"
+#include "acdbabb.h"   // AcDb::  abbreviations
+#include "adeskabb.h"  // Adesk:: abbreviations
+
+// Always use AcDbSmartObjectPointer
+//
+#define AcDbObjectPointer AcDbSmartObjectPointer
+
+
+struct ObjectIdHash
+{
+    size_t operator()(const AcDbObjectId& id) const { return std::hash<AcDbStub*>()((AcDbStub*)id); }
+};
+
+typedef std::unordered_map<AcDbObjectId, AcDbObjectId, ObjectIdHash> ObjectIdMap;
+typedef std::unordered_set<AcDbObjectId, ObjectIdHash>               ObjectIdSet;
+
+
+// Index of one database. The fillet arcs and the action bodies map 1:1, the 
+// action body is kept to be able to remove its entry when it is erased
+//
+struct DatabaseIndex
+{
+    ObjectIdMap mActionIdOfArc;   // Fillet arc -> fillet action
+    ObjectIdMap mArcIdOfBody;     // Fillet action body -> fillet arc
+    ObjectIdSet mChangedBodyIds;  // Action bodies noted by the reactor, not yet looked at
+
+    void removeBody(const AcDbObjectId& actionBodyId);
+    void updateChangedBodies();
+};
+
+
+void DatabaseIndex::removeBody(const AcDbObjectId& actionBodyId)
+{
+    const ObjectIdMap::iterator found = mArcIdOfBody.find(actionBodyId);
+    if (found != mArcIdOfBody.end())
+    {
+        mActionIdOfArc.erase(found->second);
+        mArcIdOfBody.erase(found);
+    }
+}
+
+
+void DatabaseIndex::updateChangedBodies()
+{
+    for (ObjectIdSet::const_iterator it = mChangedBodyIds.begin(); it != mChangedBodyIds.end(); ++it)
+    {
+        removeBody(*it);
+
+        AcDbObjectPointer<AssocFilletActionBody> pFilletActionBody(*it, kForRead);
+        if (pFilletActionBody.openStatus() != eOk) // E.g. erased
+            continue;
+
+        const AcDbObjectId filletArcId = pFilletActionBody->getFilletArcId();
+        if (filletArcId.isNull()) // Legal case when the radius is 0.0
+            continue;
+
+        mActionIdOfArc[filletArcId] = pFilletActionBody->parentAction();
+        mArcIdOfBody[*it]           = filletArcId;
+    }
+    mChangedBodyIds.clear();
+}
+
+
+// Notes the fillet action bodies of the actions in the network and its sub-networks,
+// without opening the actions and action bodies
+//
+static void addFilletActionBodies(const AcDbObjectId& networkId, ObjectIdSet& actionBodyIds)
+{
+    AcDbObjectPointer<AcDbAssocNetwork> pNetwork(networkId, kForRead);
+    if (pNetwork.openStatus() != eOk)
+        return;
+
+    const AcDbObjectIdArray& actionIds = pNetwork->getActions();
+    for (int i = 0; i < actionIds.length(); i++)
+    {
+        AcRxClass* const pActionClass = actionIds[i].objectClass();
+        if (pActionClass != nullptr && pActionClass->isDerivedFrom(AcDbAssocNetwork::desc()))
+        {
+            addFilletActionBodies(actionIds[i], actionBodyIds);
+            continue;
+        }
+        const AcDbObjectId actionBodyId = AcDbAssocAction::actionBody(actionIds[i]);
+        AcRxClass* const pActionBodyClass = actionBodyId.objectClass();
+        if (pActionBodyClass != nullptr && pActionBodyClass->isDerivedFrom(AssocFilletActionBody::desc()))
+            actionBodyIds.insert(actionBodyId);
+    }
+}
+
+
+// Notes the AssocFilletActionBody objects being changed in the databases that 
+// have an index, and discards the index of a database being deleted
+//
+class AssocFilletArcIndexReactor : public AcDbDatabaseReactor
+{
+public:
+    virtual void objectAppended  (const AcDbDatabase* pDb, const AcDbObject* pObj) override { noteChanged(pDb, pObj); }
+    virtual void objectUnAppended(const AcDbDatabase* pDb, const AcDbObject* pObj) override { noteChanged(pDb, pObj); }
+    virtual void objectReAppended(const AcDbDatabase* pDb, const AcDbObject* pObj) override { noteChanged(pDb, pObj); }
+    virtual void objectModified  (const AcDbDatabase* pDb, const AcDbObject* pObj) override { noteChanged(pDb, pObj); }
+    virtual void objectErased    (const AcDbDatabase* pDb, const AcDbObject* pObj, Adesk::Boolean) override { noteChanged(pDb, pObj); }
+    virtual void goodbye         (const AcDbDatabase* pDb) override;
+
+private:
+    void noteChanged(const AcDbDatabase* pDb, const AcDbObject* pObj);
+};
+
+static AssocFilletArcIndexReactor*                  spReactor = nullptr;
+static std::map<const AcDbDatabase*, DatabaseIndex> sDatabaseIndexes;
+
+
+void AssocFilletArcIndexReactor::noteChanged(const AcDbDatabase* pDb, const AcDbObject* pObj)
+{
+    if (AssocFilletActionBody::cast(pObj) == nullptr)
+        return;
+
+    const std::map<const AcDbDatabase*, DatabaseIndex>::iterator found = sDatabaseIndexes.find(pDb);
+    if (found != sDatabaseIndexes.end())
+        found->second.mChangedBodyIds.insert(pObj->objectId());
+}
+
+
+void AssocFilletArcIndexReactor::goodbye(const AcDbDatabase* pDb)
+{
+    sDatabaseIndexes.erase(pDb); // The database removes its reactors itself
+}
+
+
+// Returns the up-to-date index of the database, building it and attaching
+// the reactor to the database on the first query
+//
+static DatabaseIndex* getDatabaseIndex(AcDbDatabase* pDb)
+{
+    if (pDb == nullptr)
+        return nullptr;
+
+    std::map<const AcDbDatabase*, DatabaseIndex>::iterator found = sDatabaseIndexes.find(pDb);
+    if (found == sDatabaseIndexes.end())
+    {
+        if (spReactor == nullptr)
+            spReactor = new AssocFilletArcIndexReactor();
+        pDb->addReactor(spReactor);
+
+        found = sDatabaseIndexes.insert(std::make_pair(pDb, DatabaseIndex())).first;
+        addFilletActionBodies(AcDbAssocNetwork::getInstanceFromDatabase(pDb, false/*createIfDoesNotExist*/), 
+                              found->second.mChangedBodyIds);
+    }
+    found->second.updateChangedBodies();
+    return &found->second;
+}
+
+
+AcDbObjectId AssocFilletArcIndex::getFilletAction(const AcDbObjectId& filletArcId)
+{
+    DatabaseIndex* const pIndex = getDatabaseIndex(filletArcId.database());
+    if (pIndex == nullptr)
+        return AcDbObjectId::kNull;
+
+    const ObjectIdMap::const_iterator found = pIndex->mActionIdOfArc.find(filletArcId);
+    return found != pIndex->mActionIdOfArc.end() ? found->second : AcDbObjectId::kNull;
+}
+
+
+int AssocFilletArcIndex::getFilletActions(const AcDbObjectIdArray& filletArcIds, AcDbObjectIdArray& filletActionIdsOut)
+{
+    filletActionIdsOut.setLogicalLength(0);
+    filletActionIdsOut.setPhysicalLength(filletArcIds.length());
+
+    // The entities of a selection set usually are in one database, whose 
+    // index is only looked up again if the database changes
+    //
+    AcDbDatabase*  pLastDb       = nullptr;
+    DatabaseIndex* pIndex        = nullptr;
+    int            numFilletArcs = 0;
+
+    for (int i = 0; i < filletArcIds.length(); i++)
+    {
+        AcDbDatabase* const pDb = filletArcIds[i].database();
+        if (pDb != pLastDb)
+        {
+            pIndex  = getDatabaseIndex(pDb);
+            pLastDb = pDb;
+        }
+
+        AcDbObjectId filletActionId;
+        if (pIndex != nullptr && !filletArcIds[i].isErased()) // Same as AssocFilletActionBody::isFilletArc()
+        {
+            const ObjectIdMap::const_iterator found = pIndex->mActionIdOfArc.find(filletArcIds[i]);
+            if (found != pIndex->mActionIdOfArc.end())
+            {
+                filletActionId = found->second;
+                numFilletArcs++;
+            }
+        }
+        filletActionIdsOut.append(filletActionId);
+    }
+    return numFilletArcs;
+}
+
+
+void AssocFilletArcIndex::clear()
+{
+    if (spReactor != nullptr)
+    {
+        for (std::map<const AcDbDatabase*, DatabaseIndex>::const_iterator it = sDatabaseIndexes.begin(); it != sDatabaseIndexes.end(); ++it)
+            const_cast<AcDbDatabase*>(it->first)->removeReactor(spReactor);
+        delete spReactor;
+        spReactor = nullptr;
+    }
+    sDatabaseIndexes.clear();
+}
@@ -0,0 +1,52 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  Copyright 2014 Autodesk, Inc.  All rights reserved.
+//
+//  Use of this software is subject to the terms of the Autodesk license 
+//  agreement provided at the time of installation or download, or which 
+//  otherwise accompanies this software in either electronic or hard copy form.   
+//
+// DESCRIPTION:
+//
+// This file contains declaration of AssocFilletArcIndex class that finds the 
+// associative fillet action of a fillet AcDbArc entity without opening objects.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "dbmain.h"
+#pragma pack (push, 8)
+
+
+// In-memory index from the fillet AcDbArc entities to the associative fillet 
+// actions that control them, one per database. 
+//
+// The index of a database is built on the first query on the database, by 
+// going through the actions of its associative networks. Then it is kept up
+// to date by a database reactor that watches the AssocFilletActionBody objects
+// being appended, modified, erased and unerased. The changed action bodies are
+// only noted by the reactor and opened on the next query, because the fillet 
+// arc dependency of an action body being cloned or read from an undo filer 
+// may not be valid yet while the notification is sent
+//
+class AssocFilletArcIndex
+{
+public:
+    // Returns the fillet action that controls the given fillet arc entity, 
+    // or a null AcDbObjectId if the entity is not a fillet arc
+    //
+    static AcDbObjectId getFilletAction(const AcDbObjectId& filletArcId);
+
+    // Finds the fillet actions of all the given entities in one pass, e.g. of 
+    // a whole selection set. The entities that are not fillet arcs or that are
+    // erased get a null AcDbObjectId. Returns the number of the fillet arcs found
+    //
+    static int getFilletActions(const AcDbObjectIdArray& filletArcIds, AcDbObjectIdArray& filletActionIdsOut);
+
+    // Removes the database reactors and discards all the indexes. Must be 
+    // called when the application is unloaded
+    //
+    static void clear();
+};
+
+#pragma pack (pop)
@@ -14,10 +14,12 @@
 //////////////////////////////////////////////////////////////////////////////
 
 #include "StdAfx.h"
+#include <thread>
 #include "acedsubsel.h"
 #include "dbobjptr2.h"
 #include "eoktest.h"
 #include "AssocFilletActionBody.h"
+#include "AssocFilletLineBatch.h"
 #include "AcDbAssocManager.h"
 #include "acdbabb.h"   // AcDb::  abbreviations
 #include "adeskabb.h"  // Adesk:: abbreviations
@@ -410,3 +412,24 @@ void assocFilletCommandUI()
         setVars(pFilletActionBody->getRadius(), pFilletActionBody->isTrimInputEdge(0));
     }
 }
+
+
+// Command that checks the fillet geometry on generated curves, it does not 
+// change the drawing. The fillets evaluated concurrently must give the same 
+// results as the fillets evaluated one after another, and the line fillets 
+// computed in bulk the same as the fillets computed by AssocFilletConfig
+//
+void assocFilletTestCommandUI()
+{
+    const int kNumFillets     = 4000;
+    const int kNumLineFillets = 100000;
+    const int numThreads      = __max((int)std::thread::hardware_concurrency(), 2);
+
+    const int numDifferent = AssocFilletConfig::runConcurrentEvaluationTest(kNumFillets, numThreads);
+    acutPrintf(L"\nConcurrent evaluation on %d threads: %d of %d fillets differ from the serial evaluation.\n", 
+               numThreads, numDifferent, kNumFillets);
+
+    const int numDifferentLineFillets = AssocFilletLineBatch::runVerificationTest(kNumLineFillets);
+    acutPrintf(L"\nLine batch%s: %d of %d line fillets differ from AssocFilletConfig::evaluate().\n", 
+               AssocFilletLineBatch::isSimdSupported() ? L" with AVX2" : L" without AVX2", numDifferentLineFillets, kNumLineFillets);
+}
@@ -16,6 +16,19 @@
 
 #include "StdAfx.h"
 #include <math.h>
+#include <memory>
+#include <list>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <functional>
+#include <system_error>
+#include <atomic>
+#include <algorithm>
+#include <random>
+#include <float.h>
 #include "eoktest.h"
 #include "gelnsg3d.h"
 #include "gearc3d.h"
@@ -25,280 +38,2729 @@
 #include "geintrvl.h"
 #include "gecint3d.h"
 #include "gemat3d.h"
+#include "gebndblk3d.h"
 #include "AssocFilletConfig.h"
+#include "AssocFilletAcGeTraits.h"
 #include "acdbabb.h"   // AcDb::  abbreviations
 #include "adeskabb.h"  // Adesk:: abbreviations
 
 
+// Kind of an input curve. The curve type is looked at once, and the code that
+// depends on the curve type dispatches on the kind, e.g. the closed-form offset
+// intersection specialized for the pair of curve kinds
+//
+enum CurveKind
+{
+    kLineCurve,
+    kArcCurve,
+    kEllipseCurve,
+    kOtherCurve,
+    kNumCurveKinds
+};
+
+
+static CurveKind getCurveKind(const AcGeCurve3d* pCurve)
+{
+    switch (pCurve->type())
+    {
+    case AcGe::kLine3d:
+    case AcGe::kLineSeg3d:
+    case AcGe::kRay3d:
+        return kLineCurve;
+    case AcGe::kCircArc3d:
+        return kArcCurve;
+    case AcGe::kEllipArc3d:
+        return kEllipseCurve;
+    default:
+        return kOtherCurve;
+    }
+}
+
+
 // Could this be accomplished using some general AcGe functionality?
 //
 static AcGeCurve3d* getUnboundedCurve(const AcGeCurve3d* pCurve)
 {
     AcGeCurve3d* pUnboundedCurve = nullptr;
 
-    if (pCurve->isKindOf(AcGe::kLinearEnt3d))
+    switch (getCurveKind(pCurve))
     {
-        AcGeLine3d* const pNewLine = new AcGeLine3d();
-        static_cast<const AcGeLinearEnt3d*>(pCurve)->getLine(*pNewLine);
-        pUnboundedCurve = pNewLine;
+    case kLineCurve:
+        {
+            AcGeLine3d* const pNewLine = new AcGeLine3d();
+            static_cast<const AcGeLinearEnt3d*>(pCurve)->getLine(*pNewLine);
+            pUnboundedCurve = pNewLine;
+        }
+        break;
+    case kArcCurve:
+        {
+            const AcGeCircArc3d* const pArc = static_cast<const AcGeCircArc3d*>(pCurve);
+            pUnboundedCurve = new AcGeCircArc3d(pArc->center(), pArc->normal(), pArc->refVec(), pArc->radius(), 0.0, 2*M_PI);
+        }
+        break;
+    case kEllipseCurve:
+        {
+            const AcGeEllipArc3d* const pArc = static_cast<const AcGeEllipArc3d*>(pCurve);
+            pUnboundedCurve = new AcGeEllipArc3d(pArc->center(), 
+                                                 pArc->majorAxis(), 
+                                                 pArc->minorAxis(), 
+                                                 pArc->majorRadius(), 
+                                                 pArc->minorRadius());
+        }
+        break;
+    default:
+        pUnboundedCurve = static_cast<AcGeCurve3d*>(pCurve->copy());
+        break;
     }
-    else if (pCurve->isKindOf(AcGe::kCircArc3d))
+    return pUnboundedCurve;
+}
+    
+
+static void getUnbooundedOffsetCurves(const AcGeCurve3d*     pCurve, 
+                                      const AcGeVector3d&    normal, 
+                                      double                 radius, // Positive radius = left, negative radius = right
+                                      const AcGeTol&         tol,
+                                      AcGeCurve3d*&          pUnboundedBaseCurve, // Referenced by the offset curves
+                                      AcArray<AcGeCurve3d*>& offsetCurves)
+{
+    pUnboundedBaseCurve = nullptr;
+    offsetCurves.removeAll();
+
+    pUnboundedBaseCurve = getUnboundedCurve(pCurve);
+
+    AcGeVoidPointerArray offsetCurvesVoid;
+    pUnboundedBaseCurve->getTrimmedOffset(radius, normal, offsetCurvesVoid, AcGe::kExtend, tol);
+
+    for (int i = 0; i < offsetCurvesVoid.length(); i++)
     {
-        const AcGeCircArc3d* const pArc = static_cast<const AcGeCircArc3d*>(pCurve);
-        pUnboundedCurve = new AcGeCircArc3d(pArc->center(), pArc->normal(), pArc->refVec(), pArc->radius(), 0.0, 2*M_PI);
+        if (!VERIFY(static_cast<const AcGeEntity3d*>(offsetCurvesVoid[i])->isKindOf(AcGe::kCurve3d)))
+            continue;
+        AcGeCurve3d* const pOffsetCurve = static_cast<AcGeCurve3d*>(offsetCurvesVoid[i]);
+
+        AcGeVoidPointerArray simpleOffsetCurves;
+        if (pOffsetCurve->isKindOf(AcGe::kCompositeCrv3d))
+        {
+            static_cast<AcGeCompositeCurve3d*>(offsetCurvesVoid[i])->getCurveList(simpleOffsetCurves);
+        }
+        else
+        {
+            simpleOffsetCurves.append(pOffsetCurve);
+        }
+
+        for (int i = 0; i < simpleOffsetCurves.length(); i++)
+        {
+            offsetCurves.append(static_cast<AcGeCurve3d*>(simpleOffsetCurves[i]));
+        }
     }
-    else if (pCurve->isKindOf(AcGe::kEllipArc3d))
+}
+    
+
+static void getCurveParamRange(const AcGeCurve3d* pCurve, const AcGeTol& tol, bool& isClosed, AcGeInterval& paramInterval, double& paramPeriod)
+{
+    isClosed = false;
+    pCurve->getInterval(paramInterval);
+    paramPeriod = 0.0;
+
+    if (!VERIFY(pCurve != nullptr))
+        return;
+
+    AcGePoint3d p0, p1;
+    isClosed = pCurve->isPeriodic(paramPeriod) || 
+               pCurve->isClosed(tol)           || 
+               pCurve->hasStartPoint(p0) && pCurve->hasEndPoint(p1) && p0.isEqualTo(p1, tol);
+}
+
+
+// Takes into account that the curve may be periodic or closed, and returns the
+// shortest distance that may happen to be over the seam or end of the curve
+//
+static double paramDistance(bool isClosed, const AcGeInterval& paramInterval, double paramPeriod, double param0, double param1)
+{
+    return AssocFilletGeometry::paramDistance(isClosed, paramInterval.lowerBound(), paramInterval.upperBound(), paramPeriod, param0, param1);
+}
+
+
+// Properties of an input curve that are needed repeatedly during one evaluation.
+// They are computed once by prepareCurve() rather than for every candidate 
+// intersection, because isPeriodic(), isClosed() and isPlanar() are not cheap
+// for splines
+//
+struct PreparedCurve
+{
+    const AcGeCurve3d* mpCurve;
+    AcGe::EntityId     mType;
+    CurveKind          mKind;
+    bool               mIsLinear;
+    AcGeInterval       mInterval;
+    bool               mIsClosed;
+    double             mPeriod;   // 0.0 if the curve is not periodic
+    bool               mIsPlanar;
+    AcGeVector3d       mNormal;   // Normal of the plane of the curve, kZAxis if not planar. Not used for lines
+};
+
+
+static void prepareCurve(const AcGeCurve3d* pCurve, const AcGeTol& tol, PreparedCurve& prepared)
+{
+    prepared.mpCurve   = pCurve;
+    prepared.mType     = pCurve->type();
+    prepared.mKind     = getCurveKind(pCurve);
+    prepared.mIsLinear = prepared.mKind == kLineCurve;
+    getCurveParamRange(pCurve, tol, prepared.mIsClosed, prepared.mInterval, prepared.mPeriod);
+
+    prepared.mIsPlanar = true;
+    prepared.mNormal   = AcGeVector3d::kZAxis;
+
+    AcGePlane plane;
+    switch (prepared.mKind)
     {
-        const AcGeEllipArc3d* const pArc = static_cast<const AcGeEllipArc3d*>(pCurve);
-        pUnboundedCurve = new AcGeEllipArc3d(pArc->center(), 
-                                             pArc->majorAxis(), 
-                                             pArc->minorAxis(), 
-                                             pArc->majorRadius(), 
-                                             pArc->minorRadius());
+    case kLineCurve:
+        break;
+    case kArcCurve:
+        prepared.mNormal = static_cast<const AcGeCircArc3d*>(pCurve)->normal();
+        break;
+    case kEllipseCurve:
+        prepared.mNormal = static_cast<const AcGeEllipArc3d*>(pCurve)->normal();
+        break;
+    default:
+        prepared.mIsPlanar = pCurve->isPlanar(plane, tol);
+        if (prepared.mIsPlanar)
+            prepared.mNormal = plane.normal();  // Arbitrary normal, not good
+        break;
+    }
+}
+
+
+static double paramDistance(const PreparedCurve& curve, double param0, double param1)
+{
+    return paramDistance(curve.mIsClosed, curve.mInterval, curve.mPeriod, param0, param1);
+}
+
+
+static AcGeVector3d getCurveNormal(const PreparedCurve curve[2], const AcGeTol& tol)
+{
+    if (curve[0].mIsLinear && curve[1].mIsLinear)
+    {
+        const AcGeLinearEnt3d* const pLine0 = (const AcGeLinearEnt3d*)curve[0].mpCurve;
+        const AcGeLinearEnt3d* const pLine1 = (const AcGeLinearEnt3d*)curve[1].mpCurve;
+        const AcGeVector3d vec0 = pLine0->direction().normalize(tol);
+        const AcGeVector3d vec1 = pLine1->direction().normalize(tol);
+        AcGeVector3d normal;
+        if (vec0.isCodirectionalTo(vec1, tol))
+        {
+            const AcGePoint3d pnt0 = pLine0->pointOnLine();
+            const AcGePoint3d pnt1 = pLine1->closestPointTo(pnt0, tol);
+            normal = vec0.crossProduct(pnt1 - pnt0);
+        }
+        else
+        {
+            normal = vec0.crossProduct(vec1);
+        }
+        if (!normal.isZeroLength(tol))
+            normal.normalize(tol);
+        else
+            normal = AcGeVector3d::kZAxis;
+        return normal;
+    }
+    else if (curve[0].mIsLinear)
+    {
+        return curve[1].mNormal;
     }
     else
     {
-        pUnboundedCurve = static_cast<AcGeCurve3d*>(pCurve->copy());
+        return curve[0].mNormal;
     }
-    return pUnboundedCurve;
 }
-    
 
-static void getUnbooundedOffsetCurves(const AcGeCurve3d*     pCurve, 
-                                      const AcGeVector3d&    normal, 
-                                      double                 radius, // Positive radius = left, negative radius = right
-                                      AcGeCurve3d*&          pUnboundedBaseCurve, // Referenced by the offset curves
-                                      AcArray<AcGeCurve3d*>& offsetCurves)
+
+// Number of orientations decided by the floating-point filter and by the exact
+// fallback of getOrientation()
+//
+static std::atomic<Adesk::UInt64> sNumFilteredOrientations(0);
+static std::atomic<Adesk::UInt64> sNumExactOrientations(0);
+
+
+// Error-free transformations of floating-point sums and products, i.e. the 
+// rounded result x and the rounding error y such that x + y is exact. See
+// J.R.Shewchuk, Adaptive Precision Floating-Point Arithmetic and Fast Robust 
+// Geometric Predicates
+//
+static void twoSum(double a, double b, double& x, double& y)
+{
+    x = a + b;
+    const double bVirtual = x - a;
+    const double aVirtual = x - bVirtual;
+    y = (a - aVirtual) + (b - bVirtual);
+}
+
+
+static void twoDiff(double a, double b, double& x, double& y)
+{
+    x = a - b;
+    const double bVirtual = a - x;
+    const double aVirtual = x + bVirtual;
+    y = (a - aVirtual) + (bVirtual - b);
+}
+
+
+static void splitDouble(double a, double& aHi, double& aLo)
+{
+    const double kSplitter = 134217729.0; // 2^27 + 1
+    const double c = kSplitter * a;
+    aHi = c - (c - a);
+    aLo = a - aHi;
+}
+
+
+static void twoProduct(double a, double b, double& x, double& y)
+{
+    x = a * b;
+    double aHi, aLo, bHi, bLo;
+    splitDouble(a, aHi, aLo);
+    splitDouble(b, bHi, bLo);
+    y = aLo * bLo - (((x - aHi * bHi) - aLo * bHi) - aHi * bLo);
+}
+
+
+// Exact sign of a0*b1 - a1*b0. The determinant is first evaluated in floating 
+// point, and only if its magnitude is below the bound of the rounding error, 
+// it is evaluated exactly as a four-component expansion whose sign is the 
+// sign of its most significant non-zero component
+//
+static int getOrientation2d(double a0, double a1, double b0, double b1)
+{
+    const double kErrorBound = (3.0 + 16.0 * DBL_EPSILON) * DBL_EPSILON; // Shewchuk's ccwerrboundA
+
+    const double left  = a0 * b1;
+    const double right = a1 * b0;
+    const double det   = left - right;
+    if (fabs(det) > kErrorBound * (fabs(left) + fabs(right)))
+    {
+        sNumFilteredOrientations.fetch_add(1, std::memory_order_relaxed);
+        return det > 0.0 ? 1 : -1;
+    }
+    sNumExactOrientations.fetch_add(1, std::memory_order_relaxed);
+
+    double leftHi, leftLo, rightHi, rightLo;
+    twoProduct(a0, b1, leftHi,  leftLo);
+    twoProduct(a1, b0, rightHi, rightLo);
+
+    // (leftHi + leftLo) - (rightHi + rightLo) as the nonoverlapping expansion
+    // x[3] + x[2] + x[1] + x[0], Shewchuk's Two_Two_Diff
+    //
+    double x[4], sum, sumHi, sumLo;
+    twoDiff(leftLo, rightLo, sum,   x[0]);
+    twoSum (leftHi, sum,     sumHi, sumLo);
+    twoDiff(sumLo,  rightHi, sum,   x[1]);
+    twoSum (sumHi,  sum,     x[3],  x[2]);
+    for (int i = 3; i >= 0; i--)
+    {
+        if (x[i] != 0.0)
+            return x[i] > 0.0 ? 1 : -1;
+    }
+    return 0;
+}
+
+
+// Exact sign of normal.dotProduct(vec0.crossProduct(vec1)) for vectors lying 
+// in the plane of the normal. The vectors are projected to the coordinate plane
+// most perpendicular to the normal, which needs no arithmetic and therefore
+// keeps the predicate exact on the input coordinates
+//
+static int getOrientation(const AcGeVector3d& normal, const AcGeVector3d& vec0, const AcGeVector3d& vec1)
+{
+    int k = 2;
+    if (fabs(normal.x) > fabs(normal.y) && fabs(normal.x) > fabs(normal.z))
+        k = 0;
+    else if (fabs(normal.y) > fabs(normal.z))
+        k = 1;
+    const int i = (k + 1) % 3;
+    const int j = (k + 2) % 3;
+
+    const int orientation = getOrientation2d(vec0[i], vec0[j], vec1[i], vec1[j]);
+    return normal[k] > 0.0 ? orientation : -orientation;
+}
+
+
+// Classifies the crossing of the two curves with the given tangents at their
+// intersection. The first curve crosses the second one from left to right if 
+// the tangents form a positively oriented pair relative to the normal. Returns
+// false and leaves config[] unchanged if the tangents are exactly parallel
+//
+static bool getCrossingConfig(const AcGeVector3d& normal, const AcGeVector3d tangent[2], AcGe::AcGeXConfig config[2])
+{
+    const int orientation = getOrientation(normal, tangent[0], tangent[1]);
+    if (orientation == 0)
+        return false;
+    config[0] = orientation > 0 ? AcGe::kLeftRight : AcGe::kRightLeft;
+    config[1] = orientation > 0 ? AcGe::kRightLeft : AcGe::kLeftRight;
+    return true;
+}
+
+
+// One intersection point of the two offset curves, together with the parameters
+// on the original curves and the configuration of the curves at the intersection
+//
+struct OffsetCurveIntersection
+{
+    AcGePoint3d       mPoint;
+    double            mParam[2];
+    AcGe::AcGeXConfig mConfig[2];
+};
+
+
+// Line or circle data used by the closed-form offset intersection. The line is
+// represented as mOrigin + param*mVector, which is exactly how the input AcGe
+// line is parameterized, and the circle by its center, radius and the arc's own
+// coordinate system that defines the angular parameterization
+//
+struct AnalyticCurve
+{
+    bool         mIsLine;
+    AcGePoint3d  mOrigin;       // Point at parameter 0 of the line, or center of the circle
+    AcGeVector3d mVector;       // Derivative of the line
+    AcGeVector3d mArcNormal;    // Normal, reference vector and the "y" vector of the circle
+    AcGeVector3d mArcRefVec;
+    AcGeVector3d mArcYVec;
+    double       mRadius;       // Radius of the circle
+    AcGePoint3d  mOffsetOrigin; // Origin of the offset line
+    double       mOffsetRadius; // Radius of the offset circle
+};
+
+
+template <CurveKind kKind>
+static bool getAnalyticCurve(const AcGeCurve3d* pCurve, const AcGeVector3d& normal, double offsetDist, const AcGeTol& tol, AnalyticCurve& ac);
+
+
+template <>
+bool getAnalyticCurve<kLineCurve>(const AcGeCurve3d* pCurve, const AcGeVector3d& normal, double offsetDist, const AcGeTol& tol, AnalyticCurve& ac)
+{
+    // Evaluated at 0 and 1 rather than taken from the line, so that the parameters
+    // match those of a line segment as well as those of an unbounded line
+    //
+    ac.mIsLine = true;
+    ac.mOrigin = pCurve->evalPoint(0.0);
+    ac.mVector = pCurve->evalPoint(1.0) - ac.mOrigin;
+    if (ac.mVector.isZeroLength(tol) || fabs(ac.mVector.normal(tol).dotProduct(normal)) > tol.equalVector())
+        return false; // Degenerate line, or the line does not lie in the plane
+
+    ac.mOffsetOrigin = ac.mOrigin + offsetDist * normal.crossProduct(ac.mVector).normal(tol);
+    return true;
+}
+
+
+template <>
+bool getAnalyticCurve<kArcCurve>(const AcGeCurve3d* pCurve, const AcGeVector3d& normal, double offsetDist, const AcGeTol& tol, AnalyticCurve& ac)
+{
+    const AcGeCircArc3d* const pArc = static_cast<const AcGeCircArc3d*>(pCurve);
+    ac.mIsLine    = false;
+    ac.mOrigin    = pArc->center();
+    ac.mRadius    = pArc->radius();
+    ac.mArcNormal = pArc->normal();
+    ac.mArcRefVec = pArc->refVec();
+    ac.mArcYVec   = ac.mArcNormal.crossProduct(ac.mArcRefVec);
+    if (!ac.mArcNormal.isParallelTo(normal, tol))
+        return false; // The arc does not lie in the plane
+
+    // Offsetting to the left of the arc goes towards the center if the arc
+    // normal is the same as the plane normal, and away from the center otherwise
+    //
+    ac.mOffsetRadius = ac.mArcNormal.dotProduct(normal) > 0.0 ? ac.mRadius - offsetDist : ac.mRadius + offsetDist;
+    if (ac.mOffsetRadius <= tol.equalPoint())
+        return false; // The offset circle collapses, let the general code handle it
+    return true;
+}
+
+
+// Returns the parameter on the original curve that corresponds to the given
+// point on the offset curve, and the tangent of the original curve at that parameter
+//
+static double getAnalyticParam(const AnalyticCurve& ac, const AcGePoint3d& offsetPoint, AcGeVector3d& tangent)
+{
+    if (ac.mIsLine)
+    {
+        tangent = ac.mVector;
+        return AssocFilletGeometry::getLineParam<AcGeFilletTraits>(ac.mOffsetOrigin, ac.mVector, offsetPoint);
+    }
+    return AssocFilletGeometry::getCircleParam<AcGeFilletTraits>(ac.mOrigin, ac.mArcRefVec, ac.mArcYVec, offsetPoint, tangent);
+}
+
+
+// Intersection points of the offset lines and circles, specialized for each pair
+// of curve kinds. Returns false if the intersection is (nearly) tangential, and 
+// true with no points if the offsets do not have isolated intersections
+//
+template <CurveKind kKind0, CurveKind kKind1>
+struct AnalyticOffsetIntersector;
+
+
+// The intersections themselves are computed by the geometry core in AssocFilletGeometry.h
+//
+template <>
+struct AnalyticOffsetIntersector<kLineCurve, kLineCurve>
+{
+    static bool intersect(const AnalyticCurve ac[2], const AcGeVector3d& normal, const AcGeTol& tol, AcGePoint3d points[2], int& numPoints)
+    {
+        return AssocFilletGeometry::intersectOffsetLines<AcGeFilletTraits>(ac[0].mOffsetOrigin, ac[0].mVector, 
+                                                                           ac[1].mOffsetOrigin, ac[1].mVector, 
+                                                                           normal, tol.equalVector(), points, numPoints);
+    }
+};
+
+
+static bool intersectAnalyticLineCircle(const AnalyticCurve& line, const AnalyticCurve& circle, const AcGeTol& tol, AcGePoint3d points[2], int& numPoints)
+{
+    return AssocFilletGeometry::intersectOffsetLineCircle<AcGeFilletTraits>(line.mOffsetOrigin, line.mVector, 
+                                                                            circle.mOrigin, circle.mOffsetRadius, 
+                                                                            tol.equalPoint(), points, numPoints);
+}
+
+
+template <>
+struct AnalyticOffsetIntersector<kLineCurve, kArcCurve>
+{
+    static bool intersect(const AnalyticCurve ac[2], const AcGeVector3d&, const AcGeTol& tol, AcGePoint3d points[2], int& numPoints)
+    {
+        return intersectAnalyticLineCircle(ac[0], ac[1], tol, points, numPoints);
+    }
+};
+
+
+template <>
+struct AnalyticOffsetIntersector<kArcCurve, kLineCurve>
+{
+    static bool intersect(const AnalyticCurve ac[2], const AcGeVector3d&, const AcGeTol& tol, AcGePoint3d points[2], int& numPoints)
+    {
+        return intersectAnalyticLineCircle(ac[1], ac[0], tol, points, numPoints);
+    }
+};
+
+
+template <>
+struct AnalyticOffsetIntersector<kArcCurve, kArcCurve>
+{
+    static bool intersect(const AnalyticCurve ac[2], const AcGeVector3d& normal, const AcGeTol& tol, AcGePoint3d points[2], int& numPoints)
+    {
+        return AssocFilletGeometry::intersectOffsetCircles<AcGeFilletTraits>(ac[0].mOrigin, ac[0].mOffsetRadius, 
+                                                                             ac[1].mOrigin, ac[1].mOffsetRadius, 
+                                                                             normal, tol.equalPoint(), points, numPoints);
+    }
+};
+
+
+// Intersects the offsets of two curves in closed form when each of the curves
+// is a line or a circular arc. The offset of a line is a parallel line and
+// the offset of a circular arc is a concentric circle, therefore no offset
+// curves need to be created and no general curve-curve intersection is needed.
+// It is instantiated for each pair of the curve kinds, see getOffsetIntersectionKernel().
+//
+// Returns false if the curves are not coplanar, or the intersection is 
+// (nearly) tangential. The caller then needs to fall back to the general 
+// offset curve intersection
+//
+template <CurveKind kKind0, CurveKind kKind1>
+static bool getAnalyticOffsetIntersections(const AcGeCurve3d*                curve[2],
+                                           const AcGeVector3d&               normal,
+                                           double                            offsetDist,
+                                           const bool                        offsetLeft[2],
+                                           const AcGeTol&                    tol,
+                                           AcArray<OffsetCurveIntersection>& intersections)
+{
+    intersections.removeAll();
+
+    AnalyticCurve ac[2];
+    if (!getAnalyticCurve<kKind0>(curve[0], normal, offsetLeft[0] ? offsetDist : -offsetDist, tol, ac[0]) ||
+        !getAnalyticCurve<kKind1>(curve[1], normal, offsetLeft[1] ? offsetDist : -offsetDist, tol, ac[1]))
+    {
+        return false;
+    }
+    const AcGeVector3d toOther = ac[1].mOrigin - ac[0].mOrigin;
+    if (fabs(toOther.dotProduct(normal)) > tol.equalPoint())
+        return false; // The curves are not coplanar
+
+    AcGePoint3d points[2];
+    int         numPoints = 0;
+    if (!AnalyticOffsetIntersector<kKind0, kKind1>::intersect(ac, normal, tol, points, numPoints))
+        return false;
+
+    for (int k = 0; k < numPoints; k++)
+    {
+        OffsetCurveIntersection inters;
+        AcGeVector3d            tangent[2];
+        inters.mPoint = points[k];
+        for (int i = 0; i < 2; i++)
+        {
+            inters.mParam[i] = getAnalyticParam(ac[i], points[k], tangent[i]);
+        }
+
+        if (!getCrossingConfig(normal, tangent, inters.mConfig))
+        {
+            intersections.removeAll();
+            return false; // Tangential, let the general code classify it
+        }
+        intersections.append(inters);
+    }
+    return true;
+}
+
+
+// Line, circle or ellipse lying in the plane of the fillet. The circle and the 
+// ellipse are mCenter + mRadius[0]*cos(t)*mXAxis + mRadius[1]*sin(t)*mYAxis,
+// which is how AcGeCircArc3d and AcGeEllipArc3d are parameterized, and the line
+// is mCenter + t*mXAxis
+//
+struct PlanarConic
+{
+    bool         mIsLine;
+    AcGePoint3d  mCenter;    // Center, or the point at parameter 0 of the line
+    AcGeVector3d mXAxis;     // Unit major axis or reference vector, or the derivative of the line
+    AcGeVector3d mYAxis;     // Unit minor axis, or the unit vector to the left of the line
+    double       mRadius[2]; // Major and minor radius, equal for a circle
+    double       mLeftSide;  // 1.0 if the left side of the circle or ellipse is the inside, -1.0 otherwise
+};
+
+
+static bool getPlanarConic(const AcGeCurve3d* pCurve, const AcGeVector3d& normal, const AcGeTol& tol, PlanarConic& conic)
+{
+    conic.mLeftSide = 1.0;
+
+    const CurveKind kind = getCurveKind(pCurve);
+    if (kind == kLineCurve)
+    {
+        conic.mIsLine = true;
+        conic.mCenter = pCurve->evalPoint(0.0);
+        conic.mXAxis  = pCurve->evalPoint(1.0) - conic.mCenter;
+        if (conic.mXAxis.isZeroLength(tol) || fabs(conic.mXAxis.normal(tol).dotProduct(normal)) > tol.equalVector())
+            return false;
+        conic.mYAxis = normal.crossProduct(conic.mXAxis).normal(tol);
+        conic.mRadius[0] = conic.mRadius[1] = 0.0;
+        return true;
+    }
+
+    AcGeVector3d conicNormal;
+    conic.mIsLine = false;
+    if (kind == kArcCurve)
+    {
+        const AcGeCircArc3d* const pArc = static_cast<const AcGeCircArc3d*>(pCurve);
+        conic.mCenter    = pArc->center();
+        conic.mXAxis     = pArc->refVec().normal(tol);
+        conicNormal      = pArc->normal();
+        conic.mYAxis     = conicNormal.crossProduct(conic.mXAxis);
+        conic.mRadius[0] = conic.mRadius[1] = pArc->radius();
+    }
+    else if (kind == kEllipseCurve)
+    {
+        const AcGeEllipArc3d* const pArc = static_cast<const AcGeEllipArc3d*>(pCurve);
+        conic.mCenter    = pArc->center();
+        conic.mXAxis     = pArc->majorAxis().normal(tol);
+        conic.mYAxis     = pArc->minorAxis().normal(tol);
+        conicNormal      = conic.mXAxis.crossProduct(conic.mYAxis);
+        conic.mRadius[0] = pArc->majorRadius();
+        conic.mRadius[1] = pArc->minorRadius();
+    }
+    else
+    {
+        return false;
+    }
+    if (!conicNormal.isParallelTo(normal, tol) || conic.mRadius[0] <= tol.equalPoint() || conic.mRadius[1] <= tol.equalPoint())
+        return false;
+
+    // Left of a counter-clockwise curve is the inside
+    //
+    conic.mLeftSide = conicNormal.dotProduct(normal) > 0.0 ? 1.0 : -1.0;
+    return true;
+}
+
+
+static void evalConic(const PlanarConic& conic, double param, AcGePoint3d& point, AcGeVector3d& deriv)
+{
+    if (conic.mIsLine)
+    {
+        point = conic.mCenter + param * conic.mXAxis;
+        deriv = conic.mXAxis;
+        return;
+    }
+    const double cosParam = cos(param), sinParam = sin(param);
+    point = conic.mCenter + (conic.mRadius[0] * cosParam) * conic.mXAxis + (conic.mRadius[1] * sinParam) * conic.mYAxis;
+    deriv = (-conic.mRadius[0] * sinParam) * conic.mXAxis + (conic.mRadius[1] * cosParam) * conic.mYAxis;
+}
+
+
+// Root of the function from D. Eberly, "Distance from a Point to an Ellipse, an
+// Ellipsoid, or a Hyperellipsoid", found by bisection so that it is robust for 
+// points near the axes and near the center
+//
+static double getEllipseDistanceRoot(double r0, double z0, double z1, double g)
+{
+    const int kMaxIterations = 1100; // Enough to bisect down to adjacent doubles
+
+    const double n0 = r0 * z0;
+    double s0 = z1 - 1.0;
+    double s1 = g < 0.0 ? 0.0 : sqrt(n0 * n0 + z1 * z1) - 1.0;
+    double s  = 0.0;
+    for (int i = 0; i < kMaxIterations; i++)
+    {
+        s = 0.5 * (s0 + s1);
+        if (s == s0 || s == s1)
+            break;
+        const double ratio0 = n0 / (s + r0);
+        const double ratio1 = z1 / (s + 1.0);
+        g = ratio0 * ratio0 + ratio1 * ratio1 - 1.0;
+        if (g > 0.0)
+            s0 = s;
+        else if (g < 0.0)
+            s1 = s;
+        else
+            break;
+    }
+    return s;
+}
+
+
+// Closest point (x0, x1) on the ellipse (x0/e0)^2 + (x1/e1)^2 = 1, e0 >= e1 > 0, 
+// to the point (y0, y1) in the first quadrant. Returns the distance
+//
+static double getClosestEllipsePoint(double e0, double e1, double y0, double y1, double& x0, double& x1)
+{
+    if (y1 > 0.0)
+    {
+        if (y0 > 0.0)
+        {
+            const double z0 = y0 / e0;
+            const double z1 = y1 / e1;
+            const double g  = z0 * z0 + z1 * z1 - 1.0;
+            if (g != 0.0)
+            {
+                const double r0   = (e0 / e1) * (e0 / e1);
+                const double sbar = getEllipseDistanceRoot(r0, z0, z1, g);
+                x0 = r0 * y0 / (sbar + r0);
+                x1 = y1 / (sbar + 1.0);
+                return sqrt((x0 - y0) * (x0 - y0) + (x1 - y1) * (x1 - y1));
+            }
+            x0 = y0;
+            x1 = y1;
+            return 0.0;
+        }
+        x0 = 0.0;
+        x1 = e1;
+        return fabs(y1 - e1);
+    }
+
+    const double numer0 = e0 * y0;
+    const double denom0 = e0 * e0 - e1 * e1;
+    if (numer0 < denom0)
+    {
+        const double xde0 = numer0 / denom0;
+        x0 = e0 * xde0;
+        x1 = e1 * sqrt(__max(0.0, 1.0 - xde0 * xde0));
+        return sqrt((x0 - y0) * (x0 - y0) + x1 * x1);
+    }
+    x0 = e0;
+    x1 = 0.0;
+    return fabs(y0 - e0);
+}
+
+
+// Signed distance from the point to the conic, positive on the left side of the
+// conic. Also returns the parameter of the closest point on the conic
+//
+static double getSignedConicDistance(const PlanarConic& conic, const AcGePoint3d& point, double& closestParam)
+{
+    const AcGeVector3d vec = point - conic.mCenter;
+    if (conic.mIsLine)
+    {
+        closestParam = vec.dotProduct(conic.mXAxis) / conic.mXAxis.lengthSqrd();
+        return vec.dotProduct(conic.mYAxis);
+    }
+
+    const double x = vec.dotProduct(conic.mXAxis);
+    const double y = vec.dotProduct(conic.mYAxis);
+
+    // The closest point is found in the first quadrant, with the longer axis first
+    //
+    const bool   isSwapped = conic.mRadius[0] < conic.mRadius[1];
+    const double e0 = isSwapped ? conic.mRadius[1] : conic.mRadius[0];
+    const double e1 = isSwapped ? conic.mRadius[0] : conic.mRadius[1];
+    const double y0 = isSwapped ? fabs(y) : fabs(x);
+    const double y1 = isSwapped ? fabs(x) : fabs(y);
+    double x0 = 0.0, x1 = 0.0;
+    const double dist = getClosestEllipsePoint(e0, e1, y0, y1, x0, x1);
+
+    double closestX = isSwapped ? x1 : x0;
+    double closestY = isSwapped ? x0 : x1;
+    if (x < 0.0)
+        closestX = -closestX;
+    if (y < 0.0)
+        closestY = -closestY;
+    closestParam = atan2(closestY / conic.mRadius[1], closestX / conic.mRadius[0]);
+    if (closestParam < 0.0)
+        closestParam += 2*M_PI;
+
+    const double xr = x / conic.mRadius[0];
+    const double yr = y / conic.mRadius[1];
+    const bool isInside = xr * xr + yr * yr < 1.0;
+    return (isInside ? dist : -dist) * conic.mLeftSide;
+}
+
+
+// Intersects the offsets of two curves when at least one of them is an ellipse 
+// and the other one is a line, circle or ellipse, without creating the offset 
+// curves. The exact offset of an ellipse is not an ellipse, and getTrimmedOffset()
+// approximates it by splines that are expensive to create and to intersect.
+//
+// The trimmed offset of a curve is the set of points at the offset distance from
+// the curve on the offset side. Therefore a point of the offset of the ellipse 
+// at parameter t, point(t) + offsetDist*unit(normal x tangent(t)), lies on the 
+// offset of the other curve if its signed distance to the other curve equals 
+// the offset distance. The roots of this function of t are bracketed by sampling
+// and found by bisection. The roots on the loops of the offset of the ellipse, 
+// that getTrimmedOffset() would have trimmed away, are rejected because they are
+// closer to the ellipse than the offset distance.
+//
+// Returns false if the curves are not handled here or if an intersection is 
+// (nearly) tangential, the caller then needs to fall back to the offset curves
+//
+static bool getEllipseOffsetIntersections(const AcGeCurve3d*                curve[2],
+                                          const AcGeVector3d&               normal,
+                                          double                            offsetDist,
+                                          const bool                        offsetLeft[2],
+                                          const AcGeTol&                    tol,
+                                          AcArray<OffsetCurveIntersection>& intersections)
+{
+    const int kNumSamples       = 128;
+    const int kMaxIterations    = 100;
+    const double kParamSpacing  = 2*M_PI / kNumSamples;
+
+    intersections.removeAll();
+
+    const bool isEllipse[2] = { getCurveKind(curve[0]) == kEllipseCurve, getCurveKind(curve[1]) == kEllipseCurve, };
+    if (!isEllipse[0] && !isEllipse[1])
+        return false;
+
+    PlanarConic conic[2];
+    for (int i = 0; i < 2; i++)
+    {
+        if (!getPlanarConic(curve[i], normal, tol, conic[i]))
+            return false;
+    }
+    if (fabs((conic[1].mCenter - conic[0].mCenter).dotProduct(normal)) > tol.equalPoint())
+        return false; // The curves are not coplanar
+
+    const double signedOffsetDist[2] = { offsetLeft[0] ? offsetDist : -offsetDist, 
+                                         offsetLeft[1] ? offsetDist : -offsetDist, };
+
+    // The offset of the ellipse is walked, the other curve is only measured against
+    //
+    const int walked   = isEllipse[0] ? 0 : 1;
+    const int measured = 1 - walked;
+
+    auto getOffsetPoint = [&](double param, AcGePoint3d& offsetPoint, AcGeVector3d& tangent)
+    {
+        AcGePoint3d point;
+        evalConic(conic[walked], param, point, tangent);
+        offsetPoint = point + signedOffsetDist[walked] * normal.crossProduct(tangent).normal(tol);
+    };
+    auto evalFunction = [&](double param) -> double
+    {
+        AcGePoint3d  offsetPoint;
+        AcGeVector3d tangent;
+        getOffsetPoint(param, offsetPoint, tangent);
+        double closestParam = 0.0;
+        return getSignedConicDistance(conic[measured], offsetPoint, closestParam) - signedOffsetDist[measured];
+    };
+    auto bisect = [&](double param0, double value0, double param1) -> double
+    {
+        for (int k = 0; k < kMaxIterations && param1 - param0 > 1e-14; k++)
+        {
+            const double midParam = 0.5 * (param0 + param1);
+            const double midValue = evalFunction(midParam);
+            if (midValue == 0.0)
+                return midParam;
+            if ((midValue > 0.0) == (value0 > 0.0))
+            {
+                param0 = midParam;
+                value0 = midValue;
+            }
+            else
+            {
+                param1 = midParam;
+            }
+        }
+        return 0.5 * (param0 + param1);
+    };
+
+    double value[kNumSamples];
+    for (int k = 0; k < kNumSamples; k++)
+    {
+        value[k] = evalFunction(k * kParamSpacing);
+    }
+
+    std::vector<double> roots;
+    for (int k = 0; k < kNumSamples; k++)
+    {
+        const double param = k * kParamSpacing;
+        const double prevValue = value[(k + kNumSamples - 1) % kNumSamples];
+        const double nextValue = value[(k + 1) % kNumSamples];
+
+        if (value[k] == 0.0)
+        {
+            roots.push_back(param);
+        }
+        else if (nextValue != 0.0 && (value[k] > 0.0) != (nextValue > 0.0))
+        {
+            roots.push_back(bisect(param, value[k], param + kParamSpacing));
+        }
+        else if ((value[k] > 0.0) == (prevValue > 0.0) && (value[k] > 0.0) == (nextValue > 0.0) &&
+                 fabs(value[k]) <= fabs(prevValue) && fabs(value[k]) <= fabs(nextValue))
+        {
+            // Local minimum of |f| without a sign change. Two roots closer than the 
+            // sample spacing may hide here, find the minimum by golden section search
+            //
+            const double sign = value[k] > 0.0 ? 1.0 : -1.0;
+            const double kGolden = 0.5 * (sqrt(5.0) - 1.0);
+            double lower = param - kParamSpacing, upper = param + kParamSpacing;
+            for (int n = 0; n < kMaxIterations && upper - lower > 1e-12; n++)
+            {
+                const double param0 = upper - kGolden * (upper - lower);
+                const double param1 = lower + kGolden * (upper - lower);
+                if (sign * evalFunction(param0) < sign * evalFunction(param1))
+                    upper = param1;
+                else
+                    lower = param0;
+            }
+            const double minParam = 0.5 * (lower + upper);
+            const double minValue = evalFunction(minParam);
+            if (fabs(minValue) <= tol.equalPoint())
+                return false; // Tangential
+            if ((minValue > 0.0) != (value[k] > 0.0))
+            {
+                roots.push_back(bisect(param - kParamSpacing, prevValue, minParam));
+                roots.push_back(bisect(minParam, minValue, param + kParamSpacing));
+            }
+        }
+    }
+
+    for (size_t k = 0; k < roots.size(); k++)
+    {
+        double walkedParam = fmod(roots[k], 2*M_PI);
+        if (walkedParam < 0.0)
+            walkedParam += 2*M_PI;
+
+        AcGePoint3d  offsetPoint;
+        AcGeVector3d tangent[2];
+        getOffsetPoint(walkedParam, offsetPoint, tangent[walked]);
+
+        // Points on the loops of the offset curve are closer to the ellipse than the
+        // offset distance, the trimmed offset does not contain them
+        //
+        double closestParam = 0.0;
+        if (fabs(getSignedConicDistance(conic[walked], offsetPoint, closestParam) - signedOffsetDist[walked]) > tol.equalPoint())
+            continue;
+
+        double measuredParam = 0.0;
+        getSignedConicDistance(conic[measured], offsetPoint, measuredParam);
+        AcGePoint3d measuredPoint;
+        evalConic(conic[measured], measuredParam, measuredPoint, tangent[measured]);
+
+        OffsetCurveIntersection inters;
+        inters.mPoint            = offsetPoint;
+        inters.mParam[walked]    = walkedParam;
+        inters.mParam[measured]  = measuredParam;
+
+        if (!getCrossingConfig(normal, tangent, inters.mConfig))
+        {
+            intersections.removeAll();
+            return false; // Tangential, let the general code classify it
+        }
+        intersections.append(inters);
+    }
+    return true;
+}
+
+
+// Closed-form offset intersection for a pair of curve kinds, see getOffsetIntersectionKernel()
+//
+typedef bool (*OffsetIntersectionKernel)(const AcGeCurve3d*                curve[2],
+                                         const AcGeVector3d&               normal,
+                                         double                            offsetDist,
+                                         const bool                        offsetLeft[2],
+                                         const AcGeTol&                    tol,
+                                         AcArray<OffsetCurveIntersection>& intersections);
+
+
+static bool getNoClosedFormOffsetIntersections(const AcGeCurve3d*                [2],
+                                               const AcGeVector3d&               ,
+                                               double                            ,
+                                               const bool                        [2],
+                                               const AcGeTol&                    ,
+                                               AcArray<OffsetCurveIntersection>& intersections)
+{
+    intersections.removeAll();
+    return false;
+}
+
+
+// The closed-form intersection of the offsets is chosen once for the kinds of
+// the two curves, so that the type tests and the branching on the curve types 
+// are not repeated for every evaluation of the fillet
+//
+static const OffsetIntersectionKernel sOffsetIntersectionKernels[kNumCurveKinds][kNumCurveKinds] =
+{
+    // kLineCurve
+    {
+        &getAnalyticOffsetIntersections<kLineCurve, kLineCurve>,
+        &getAnalyticOffsetIntersections<kLineCurve, kArcCurve>,
+        &getEllipseOffsetIntersections,
+        &getNoClosedFormOffsetIntersections,
+    },
+    // kArcCurve
+    {
+        &getAnalyticOffsetIntersections<kArcCurve, kLineCurve>,
+        &getAnalyticOffsetIntersections<kArcCurve, kArcCurve>,
+        &getEllipseOffsetIntersections,
+        &getNoClosedFormOffsetIntersections,
+    },
+    // kEllipseCurve
+    {
+        &getEllipseOffsetIntersections,
+        &getEllipseOffsetIntersections,
+        &getEllipseOffsetIntersections,
+        &getNoClosedFormOffsetIntersections,
+    },
+    // kOtherCurve
+    {
+        &getNoClosedFormOffsetIntersections,
+        &getNoClosedFormOffsetIntersections,
+        &getNoClosedFormOffsetIntersections,
+        &getNoClosedFormOffsetIntersections,
+    },
+};
+
+
+static OffsetIntersectionKernel getOffsetIntersectionKernel(CurveKind kind0, CurveKind kind1)
+{
+    return sOffsetIntersectionKernels[kind0][kind1];
+}
+
+
+// Axis-aligned bounding box of a curve, slightly enlarged by the tolerance.
+// Unbounded curves (such as the offset of an infinite line) get an infinite box
+//
+struct CurveBox
+{
+    AcGePoint3d mMin;
+    AcGePoint3d mMax;
+};
+
+
+static CurveBox getCurveBox(const AcGeCurve3d* pCurve, const AcGeTol& tol)
+{
+    CurveBox box;
+    AcGeInterval interval;
+    pCurve->getInterval(interval);
+    if (!interval.isBounded())
+    {
+        box.mMin.set(-DBL_MAX, -DBL_MAX, -DBL_MAX);
+        box.mMax.set( DBL_MAX,  DBL_MAX,  DBL_MAX);
+        return box;
+    }
+    pCurve->orthoBoundBlock().getMinMaxPoints(box.mMin, box.mMax);
+    const AcGeVector3d margin(tol.equalPoint(), tol.equalPoint(), tol.equalPoint());
+    box.mMin -= margin;
+    box.mMax += margin;
+    return box;
+}
+
+
+// Finds all pairs of overlapping boxes, one box from each of the two arrays, using
+// a sweep along the x axis. The pairs are returned sorted by the first and then 
+// the second index, i.e. in the same order as a nested loop over all the pairs
+//
+static void getOverlappingBoxPairs(const AcArray<CurveBox>&          boxes0, 
+                                   const AcArray<CurveBox>&          boxes1, 
+                                   std::vector<std::pair<int, int> >& pairs)
+{
+    pairs.clear();
+
+    struct Event
+    {
+        double mX;
+        bool   mIsEnd;
+        int    mSet;
+        int    mIndex;
+        bool operator<(const Event& other) const
+        {
+            if (mX != other.mX)
+                return mX < other.mX;
+            return !mIsEnd && other.mIsEnd; // Starts before ends, so that touching boxes overlap
+        }
+    };
+
+    const AcArray<CurveBox>* const boxes[2] = { &boxes0, &boxes1, };
+    std::vector<Event> events;
+    events.reserve(2 * (boxes0.length() + boxes1.length()));
+    for (int set = 0; set < 2; set++)
+    {
+        for (int i = 0; i < boxes[set]->length(); i++)
+        {
+            const Event startEvent = { (*boxes[set])[i].mMin.x, false, set, i, };
+            const Event endEvent   = { (*boxes[set])[i].mMax.x, true,  set, i, };
+            events.push_back(startEvent);
+            events.push_back(endEvent);
+        }
+    }
+    std::sort(events.begin(), events.end());
+
+    std::vector<int> active[2];
+    for (size_t k = 0; k < events.size(); k++)
+    {
+        const Event& event = events[k];
+        std::vector<int>& activeOfSet = active[event.mSet];
+        if (event.mIsEnd)
+        {
+            activeOfSet.erase(std::find(activeOfSet.begin(), activeOfSet.end(), event.mIndex));
+            continue;
+        }
+
+        const CurveBox& box = (*boxes[event.mSet])[event.mIndex];
+        const std::vector<int>& activeOfOtherSet = active[1 - event.mSet];
+        for (size_t n = 0; n < activeOfOtherSet.size(); n++)
+        {
+            const CurveBox& otherBox = (*boxes[1 - event.mSet])[activeOfOtherSet[n]];
+            if (box.mMin.y <= otherBox.mMax.y && otherBox.mMin.y <= box.mMax.y &&
+                box.mMin.z <= otherBox.mMax.z && otherBox.mMin.z <= box.mMax.z)
+            {
+                pairs.push_back(event.mSet == 0 ? std::make_pair(event.mIndex, activeOfOtherSet[n])
+                                                : std::make_pair(activeOfOtherSet[n], event.mIndex));
+            }
+        }
+        activeOfSet.push_back(event.mIndex);
+    }
+    std::sort(pairs.begin(), pairs.end());
+}
+
+
+// Unbounded base curve together with its trimmed offset split into simple curves.
+// The offset curves may reference the base curve, therefore they are owned together.
+// For zero offset distance the base curve itself is the only offset curve.
+//
+// The bounding boxes of the offset curves are precomputed, so that a cached set
+// does not need to compute them again. The copy constructor copies the curves
+//
+class OffsetCurveSet
+{
+public:
+    OffsetCurveSet(const AcGeCurve3d* pCurve, const AcGeVector3d& normal, double offsetDist, const AcGeTol& tol);
+    OffsetCurveSet(const OffsetCurveSet& other);
+    ~OffsetCurveSet();
+
+    const AcGeCurve3d*           baseCurve()        const { return mBaseCurve;        }
+    const AcArray<AcGeCurve3d*>& offsetCurves()     const { return mOffsetCurves;     }
+    const AcArray<CurveBox>&     offsetCurveBoxes() const { return mOffsetCurveBoxes; }
+
+    // Rough estimate of the memory occupied by the curves
+    //
+    size_t memorySize() const;
+
+private:
+    OffsetCurveSet& operator=(const OffsetCurveSet&); // Not assignable
+
+    AcGeCurve3d*          mBaseCurve;
+    AcArray<AcGeCurve3d*> mOffsetCurves;
+    AcArray<CurveBox>     mOffsetCurveBoxes;
+};
+
+
+OffsetCurveSet::OffsetCurveSet(const AcGeCurve3d* pCurve, const AcGeVector3d& normal, double offsetDist, const AcGeTol& tol)
+  : mBaseCurve(nullptr)
+{
+    if (offsetDist == 0.0)
+    {
+        mBaseCurve = getUnboundedCurve(pCurve);
+        mOffsetCurves.append(mBaseCurve);
+    }
+    else
+    {
+        getUnbooundedOffsetCurves(pCurve, normal, offsetDist, tol, mBaseCurve, mOffsetCurves);
+    }
+
+    for (int i = 0; i < mOffsetCurves.length(); i++)
+    {
+        mOffsetCurveBoxes.append(getCurveBox(mOffsetCurves[i], tol));
+    }
+}
+
+
+OffsetCurveSet::OffsetCurveSet(const OffsetCurveSet& other)
+  : mBaseCurve(static_cast<AcGeCurve3d*>(other.mBaseCurve->copy())), mOffsetCurveBoxes(other.mOffsetCurveBoxes)
+{
+    for (int i = 0; i < other.mOffsetCurves.length(); i++)
+    {
+        if (other.mOffsetCurves[i] == other.mBaseCurve)
+            mOffsetCurves.append(mBaseCurve);
+        else
+            mOffsetCurves.append(static_cast<AcGeCurve3d*>(other.mOffsetCurves[i]->copy()));
+    }
+}
+
+
+OffsetCurveSet::~OffsetCurveSet()
+{
+    for (int i = 0; i < mOffsetCurves.length(); i++)
+    {
+        if (mOffsetCurves[i] != mBaseCurve) // Zero offset uses the base curve itself
+            delete mOffsetCurves[i];
+    }
+    delete mBaseCurve;
+}
+
+
+static size_t estimateCurveMemorySize(const AcGeCurve3d* pCurve)
+{
+    size_t size = 256; // About the size of a simple AcGe curve
+    if (pCurve->isKindOf(AcGe::kNurbCurve3d))
+    {
+        const AcGeNurbCurve3d* const pNurb = static_cast<const AcGeNurbCurve3d*>(pCurve);
+        size += pNurb->numControlPoints() * (sizeof(AcGePoint3d) + sizeof(double)) + pNurb->numKnots() * sizeof(double);
+    }
+    else if (pCurve->isKindOf(AcGe::kCompositeCrv3d))
+    {
+        AcGeVoidPointerArray curves;
+        static_cast<const AcGeCompositeCurve3d*>(pCurve)->getCurveList(curves);
+        for (int i = 0; i < curves.length(); i++)
+        {
+            size += estimateCurveMemorySize(static_cast<const AcGeCurve3d*>(curves[i]));
+        }
+    }
+    return size;
+}
+
+
+size_t OffsetCurveSet::memorySize() const
+{
+    size_t size = sizeof(*this) + estimateCurveMemorySize(mBaseCurve) + mOffsetCurveBoxes.length() * sizeof(CurveBox);
+    for (int i = 0; i < mOffsetCurves.length(); i++)
+    {
+        if (mOffsetCurves[i] != mBaseCurve)
+            size += estimateCurveMemorySize(mOffsetCurves[i]);
+    }
+    return size;
+}
+
+
+static void appendValue(std::vector<double>& key, double value)
+{
+    key.push_back(value == 0.0 ? 0.0 : value); // Do not distinguish -0.0 from 0.0
+}
+
+
+static void appendPoint(std::vector<double>& key, const AcGePoint3d& pnt)
+{
+    appendValue(key, pnt.x);
+    appendValue(key, pnt.y);
+    appendValue(key, pnt.z);
+}
+
+
+static void appendVector(std::vector<double>& key, const AcGeVector3d& vec)
+{
+    appendValue(key, vec.x);
+    appendValue(key, vec.y);
+    appendValue(key, vec.z);
+}
+
+
+static void appendInterval(std::vector<double>& key, const AcGeInterval& interval)
+{
+    appendValue(key, interval.isBoundedBelow() ? 1.0 : 0.0);
+    appendValue(key, interval.isBoundedBelow() ? interval.lowerBound() : 0.0);
+    appendValue(key, interval.isBoundedAbove() ? 1.0 : 0.0);
+    appendValue(key, interval.isBoundedAbove() ? interval.upperBound() : 0.0);
+}
+
+
+// Appends all the data that defines the unbounded curve created by getUnboundedCurve()
+// from the given curve. Two curves with the same fingerprint produce the same offset 
+// curves. Returns false if the curve type is not known and cannot be fingerprinted
+//
+static bool appendCurveFingerprint(const AcGeCurve3d* pCurve, std::vector<double>& key)
+{
+    appendValue(key, (double)pCurve->type());
+
+    if (pCurve->isKindOf(AcGe::kLinearEnt3d))
+    {
+        appendPoint(key, pCurve->evalPoint(0.0));
+        appendPoint(key, pCurve->evalPoint(1.0));
+    }
+    else if (pCurve->isKindOf(AcGe::kCircArc3d))
+    {
+        const AcGeCircArc3d* const pArc = static_cast<const AcGeCircArc3d*>(pCurve);
+        appendPoint (key, pArc->center());
+        appendVector(key, pArc->normal());
+        appendVector(key, pArc->refVec());
+        appendValue (key, pArc->radius());
+    }
+    else if (pCurve->isKindOf(AcGe::kEllipArc3d))
+    {
+        const AcGeEllipArc3d* const pArc = static_cast<const AcGeEllipArc3d*>(pCurve);
+        appendPoint (key, pArc->center());
+        appendVector(key, pArc->majorAxis());
+        appendVector(key, pArc->minorAxis());
+        appendValue (key, pArc->majorRadius());
+        appendValue (key, pArc->minorRadius());
+    }
+    else if (pCurve->isKindOf(AcGe::kNurbCurve3d))
+    {
+        int              degree = 0;
+        Adesk::Boolean   rational = false, periodic = false;
+        AcGeKnotVector   knots;
+        AcGePoint3dArray controlPoints;
+        AcGeDoubleArray  weights;
+        static_cast<const AcGeNurbCurve3d*>(pCurve)->getDefinitionData(degree, rational, periodic, knots, controlPoints, weights);
+
+        appendValue(key, degree);
+        appendValue(key, rational ? 1.0 : 0.0);
+        appendValue(key, periodic ? 1.0 : 0.0);
+        appendValue(key, knots.length());
+        for (int i = 0; i < knots.length(); i++)
+            appendValue(key, knots[i]);
+        appendValue(key, controlPoints.length());
+        for (int i = 0; i < controlPoints.length(); i++)
+            appendPoint(key, controlPoints[i]);
+        appendValue(key, weights.length());
+        for (int i = 0; i < weights.length(); i++)
+            appendValue(key, weights[i]);
+    }
+    else if (pCurve->isKindOf(AcGe::kCompositeCrv3d))
+    {
+        AcGeVoidPointerArray curves;
+        static_cast<const AcGeCompositeCurve3d*>(pCurve)->getCurveList(curves);
+        appendValue(key, curves.length());
+        for (int i = 0; i < curves.length(); i++)
+        {
+            // The sub-curves are bounded, e.g. two composites that only differ
+            // by the sweep of an end arc have different offsets
+            //
+            const AcGeCurve3d* const pSubCurve = static_cast<const AcGeCurve3d*>(curves[i]);
+            if (!appendCurveFingerprint(pSubCurve, key))
+                return false;
+            AcGeInterval subInterval;
+            pSubCurve->getInterval(subInterval);
+            appendInterval(key, subInterval);
+        }
+    }
+    else
+    {
+        return false;
+    }
+
+    if (getCurveKind(pCurve) == kOtherCurve)
+    {
+        // Splines and composite curves are copied with their parameter range
+        //
+        AcGeInterval interval;
+        pCurve->getInterval(interval);
+        appendInterval(key, interval);
+    }
+    return true;
+}
+
+
+// Process-wide least-recently-used cache of OffsetCurveSets, keyed by the 
+// fingerprint of the base curve, the signed offset distance, the normal and 
+// the tolerance.
+//
+// During grip dragging usually only one of the two input curves changes, and
+// the offset curves of the other one are found in the cache instead of being
+// computed by the expensive getTrimmedOffset() again.
+//
+// Even the const AcGe curves are not safe to use from several threads at the 
+// same time, so the cached sets are only used under the mutex, and every caller
+// gets its own copy. Copying the curves is much cheaper than offsetting them
+//
+class OffsetCurveCache
+{
+public:
+    OffsetCurveCache();
+
+    std::shared_ptr<const OffsetCurveSet> getOffsetCurves(const AcGeCurve3d*  pCurve, 
+                                                          const AcGeVector3d& normal, 
+                                                          double              offsetDist,
+                                                          const AcGeTol&      tol);
+
+    void   setMemoryBudget(size_t memoryBudget);
+    size_t memoryBudget() const;
+    void   getStatistics(Adesk::UInt64& hits, Adesk::UInt64& misses, size_t& memoryUsed) const;
+    void   clear();
+
+private:
+    typedef std::vector<double> Key;
+
+    struct KeyHash
+    {
+        size_t operator()(const Key& key) const;
+    };
+
+    struct Entry
+    {
+        Key                                   mKey;
+        std::shared_ptr<const OffsetCurveSet> mOffsetCurveSet;
+        size_t                                mMemorySize;
+    };
+    typedef std::list<Entry> EntryList; // The most recently used entry is the first one
+
+    void evictOverBudget(); // The mutex must be locked
+
+    mutable std::mutex                                     mMutex;
+    EntryList                                              mEntries;
+    std::unordered_map<Key, EntryList::iterator, KeyHash> mIndex;
+    size_t                                                 mMemoryBudget;
+    size_t                                                 mMemoryUsed;
+    Adesk::UInt64                                          mHits;
+    Adesk::UInt64                                          mMisses;
+};
+
+static OffsetCurveCache sOffsetCurveCache;
+
+
+size_t OffsetCurveCache::KeyHash::operator()(const Key& key) const
+{
+    // FNV-1a over the bytes of the doubles
+    //
+    size_t hash = 2166136261U;
+    const unsigned char* const pBytes = reinterpret_cast<const unsigned char*>(key.data());
+    const size_t numBytes = key.size() * sizeof(double);
+    for (size_t i = 0; i < numBytes; i++)
+    {
+        hash ^= pBytes[i];
+        hash *= 16777619U;
+    }
+    return hash;
+}
+
+
+OffsetCurveCache::OffsetCurveCache()
+  : mMemoryBudget(32*1024*1024), mMemoryUsed(0), mHits(0), mMisses(0)
+{
+}
+
+
+std::shared_ptr<const OffsetCurveSet> OffsetCurveCache::getOffsetCurves(const AcGeCurve3d*  pCurve, 
+                                                                        const AcGeVector3d& normal, 
+                                                                        double              offsetDist,
+                                                                        const AcGeTol&      tol)
+{
+    Key key;
+    const bool isCacheable = appendCurveFingerprint(pCurve, key);
+    appendValue (key, offsetDist);
+    appendVector(key, normal);
+    appendValue (key, tol.equalPoint());
+    appendValue (key, tol.equalVector());
+
+    if (isCacheable)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        const auto found = mIndex.find(key);
+        if (found != mIndex.end())
+        {
+            mHits++;
+            mEntries.splice(mEntries.begin(), mEntries, found->second); // Make it the most recently used
+            return std::shared_ptr<const OffsetCurveSet>(new OffsetCurveSet(*found->second->mOffsetCurveSet));
+        }
+        mMisses++;
+    }
+
+    // Create the offset curves without holding the lock, it is the expensive part
+    //
+    const std::shared_ptr<const OffsetCurveSet> pOffsetCurveSet(new OffsetCurveSet(pCurve, normal, offsetDist, tol));
+    if (!isCacheable)
+        return pOffsetCurveSet;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mMemoryBudget == 0 || mIndex.find(key) != mIndex.end())
+        return pOffsetCurveSet; // Caching disabled, or created concurrently by another thread
+
+    Entry entry;
+    entry.mKey            = key;
+    entry.mOffsetCurveSet.reset(new OffsetCurveSet(*pOffsetCurveSet)); // The caller keeps the created one
+    entry.mMemorySize     = entry.mOffsetCurveSet->memorySize();
+    mEntries.push_front(entry);
+    mIndex[key] = mEntries.begin();
+    mMemoryUsed += entry.mMemorySize;
+    evictOverBudget();
+    return pOffsetCurveSet;
+}
+
+
+void OffsetCurveCache::evictOverBudget()
+{
+    while (mMemoryUsed > mMemoryBudget && !mEntries.empty())
+    {
+        const Entry& leastRecentlyUsed = mEntries.back();
+        mMemoryUsed -= leastRecentlyUsed.mMemorySize;
+        mIndex.erase(leastRecentlyUsed.mKey);
+        mEntries.pop_back();
+    }
+}
+
+
+void OffsetCurveCache::setMemoryBudget(size_t memoryBudget)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mMemoryBudget = memoryBudget;
+    evictOverBudget();
+}
+
+
+size_t OffsetCurveCache::memoryBudget() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mMemoryBudget;
+}
+
+
+void OffsetCurveCache::getStatistics(Adesk::UInt64& hits, Adesk::UInt64& misses, size_t& memoryUsed) const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    hits       = mHits;
+    misses     = mMisses;
+    memoryUsed = mMemoryUsed;
+}
+
+
+void OffsetCurveCache::clear()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mIndex.clear();
+    mEntries.clear();
+    mMemoryUsed = 0;
+}
+
+
+// Persistent worker threads used to intersect the pairs of offset sub-curves
+// concurrently. The threads are created by resize(), i.e. by 
+// AssocFilletConfig::setIntersectionThreadCount(), and wait for work between
+// the evaluations, so no threads are created while evaluating.
+//
+// Only one run() is in progress at a time. If another thread is running a 
+// batch already, run() returns false and the caller does the work itself
+//
+class IntersectionThreadPool
+{
+public:
+    IntersectionThreadPool();
+    ~IntersectionThreadPool();
+
+    // Stops the current worker threads and starts the given number of new ones.
+    // Returns the number of worker threads actually started, which is less than
+    // requested if the system could not create more threads
+    //
+    int resize(int numWorkers);
+
+    int numWorkers() const;
+
+    // Calls task(threadIndex) once on each worker thread with threadIndex 1..numWorkers 
+    // and once on the calling thread with threadIndex 0, and returns when all the
+    // calls have returned. Returns false without calling the task if the pool has
+    // no workers or is busy with another run()
+    //
+    bool run(const std::function<void(int threadIndex)>& task);
+
+private:
+    void workerLoop(int threadIndex, unsigned startGeneration);
+    void stopWorkers(); // mRunMutex must be locked
+
+    std::mutex                          mRunMutex; // Held for the whole run() or resize()
+    mutable std::mutex                  mMutex;    // Guards the members below
+    std::condition_variable             mWorkAvailable;
+    std::condition_variable             mWorkDone;
+    std::vector<std::thread>            mWorkers;
+    const std::function<void(int)>*     mpTask;
+    unsigned                            mGeneration; // Incremented for each run()
+    int                                 mNumPending; // Workers still running the current task
+    bool                                mIsStopping;
+};
+
+static IntersectionThreadPool sIntersectionThreadPool;
+
+
+IntersectionThreadPool::IntersectionThreadPool() 
+  : mpTask(nullptr), mGeneration(0), mNumPending(0), mIsStopping(false)
+{
+}
+
+
+IntersectionThreadPool::~IntersectionThreadPool()
+{
+    // The application sets the thread count back to 1 when it is unloaded, 
+    // joining threads from a static destructor could deadlock
+    //
+    VERIFY(mWorkers.empty());
+}
+
+
+int IntersectionThreadPool::resize(int numWorkers)
+{
+    std::lock_guard<std::mutex> runLock(mRunMutex);
+    stopWorkers();
+
+    unsigned generation;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mIsStopping = false;
+        generation  = mGeneration;
+    }
+    for (int i = 0; i < numWorkers; i++)
+    {
+        try
+        {
+            mWorkers.push_back(std::thread(&IntersectionThreadPool::workerLoop, this, i + 1, generation));
+        }
+        catch (const std::system_error&)
+        {
+            break; // Keep the threads that could be created
+        }
+    }
+    std::lock_guard<std::mutex> lock(mMutex);
+    return (int)mWorkers.size();
+}
+
+
+int IntersectionThreadPool::numWorkers() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return (int)mWorkers.size();
+}
+
+
+void IntersectionThreadPool::stopWorkers()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mIsStopping = true;
+    }
+    mWorkAvailable.notify_all();
+    for (size_t i = 0; i < mWorkers.size(); i++)
+    {
+        mWorkers[i].join();
+    }
+    std::lock_guard<std::mutex> lock(mMutex);
+    mWorkers.clear();
+}
+
+
+bool IntersectionThreadPool::run(const std::function<void(int threadIndex)>& task)
+{
+    std::unique_lock<std::mutex> runLock(mRunMutex, std::try_to_lock);
+    if (!runLock.owns_lock())
+        return false;
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mWorkers.empty())
+            return false;
+        mpTask      = &task;
+        mNumPending = (int)mWorkers.size();
+        mGeneration++;
+    }
+    mWorkAvailable.notify_all();
+
+    task(0); // The calling thread does its share too
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (mNumPending > 0)
+    {
+        mWorkDone.wait(lock);
+    }
+    mpTask = nullptr;
+    return true;
+}
+
+
+void IntersectionThreadPool::workerLoop(int threadIndex, unsigned startGeneration)
+{
+    unsigned generation = startGeneration;
+    for (;;)
+    {
+        const std::function<void(int)>* pTask = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            while (!mIsStopping && mGeneration == generation)
+            {
+                mWorkAvailable.wait(lock);
+            }
+            if (mIsStopping)
+                return;
+            generation = mGeneration;
+            pTask      = mpTask;
+        }
+
+        (*pTask)(threadIndex);
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (--mNumPending == 0)
+            mWorkDone.notify_all();
+    }
+}
+
+
+// Iterates over all intersections of the offsets of the two given curves.
+//
+// If each of the curves is a line or a circular arc, the intersections are
+// computed in closed form up front, and if one of them is an ellipse and the
+// other one is a line, arc or ellipse, they are found by getEllipseOffsetIntersections()
+// without creating the offset curves. The closed form is chosen once for the 
+// pair of curve kinds in the constructor. Otherwise unbounded offset curves are
+// obtained from the offset curve cache and intersected using AcGeCurveCurveInt3d.
+// Only the pairs of offset curves whose bounding boxes overlap are intersected.
+//
+// Nothing is computed until the first call to getNext() or resetToBaseCurves(), 
+// so an iterator that ends up not being used costs nothing.
+//
+// If AssocFilletConfig::intersectionThreadCount() is more than 1 and there are
+// multiple pairs of offset curves, the pairs are intersected in batches on the
+// worker threads of sIntersectionThreadPool. A batch is only intersected when 
+// getNext() gets to it, so the caller can still stop after the first batches.
+// Each pair is intersected on copies of the offset curves that are only used 
+// by the thread intersecting it, as the cached offset curves are shared. The 
+// intersections are returned in the same order as if the pairs were intersected
+// one after another
+//
+class AcDbOffsetCurveIntersectionIter
+{
+public:
+    AcDbOffsetCurveIntersectionIter(const AcGeCurve3d*  curve[2],
+                                    const AcGeVector3d& normal, 
+                                    double              offsetDist,
+                                    bool                offsetLeft[2],
+                                    const AcGeTol&      tol);
+    ~AcDbOffsetCurveIntersectionIter();
+
+    // Returns the next intersection point between the two offset curves.
+    // Also returns parametric position of the intersection. The parameterization
+    // of the offset curves seems to match parameterization of the original curves,
+    // therefore the parametric position is on the original curves at the closest
+    // point to the offset curve intersection
+    //
+    bool getNext(AcGePoint3d&      intersPoint,
+                 double            param[2],   
+                 AcGe::AcGeXConfig config[2]);
+
+    // Restarts the iteration so that it returns intersections of the two unbounded
+    // base (non-offset) curves, reusing the unbounded curves that have already
+    // been created if the given curves are the ones the iterator was created for
+    //
+    void resetToBaseCurves(const AcGeCurve3d* curve[2]);
+
+    // Same as paramDistance() on the unbounded base curve
+    //
+    double baseParamDistance(int index, double param0, double param1) const;
+
+    // The pair of offset sub-curves with the given indices is intersected first, 
+    // if their bounding boxes overlap. Must be called before the first getNext()
+    //
+    void setPreferredCurvePair(int index0, int index1);
+
+    // Returns the indices of the offset sub-curves that gave the intersection 
+    // last returned by getNext(). Returns false for the closed-form intersections
+    //
+    bool getCurrentCurvePair(int& index0, int& index1) const;
+
+    // Number of offset sub-curves of the curve with the given index
+    //
+    int numOffsetCurves(int index) const { return mOffsetCurves[index].length(); }
+
+private:
+    void initialize();
+    void setAnalytic();
+    void intersectNextCurvePairBatch();
+
+    const AcGeCurve3d*                    mCurve[2];
+    double                                mOffsetDist;
+    bool                                  mOffsetLeft[2];
+    bool                                  mIsInitialized;
+    std::shared_ptr<const OffsetCurveSet> mOffsetCurveSet[2]; // Owns the curves below, not shared with other iterators
+    const AcGeCurve3d*                    mBaseCurve[2];
+    PreparedCurve                         mPreparedBaseCurve[2]; // Prepared by resetToBaseCurves()
+    AcArray<const AcGeCurve3d*>           mOffsetCurves[2];
+    AcGeVector3d                          mNormal;
+    AcGeTol                               mTol;
+    AcGeCurveCurveInt3d                   mCurrentCurveCurveInters;
+    std::vector<std::pair<int, int> >     mCurvePairs; // Indices of offset curves with overlapping boxes
+    std::pair<int, int>                   mPreferredCurvePair;
+    int                                   mCurrentCurvePairIndex;
+    int                                   mCurrentIntersectionIndex;
+
+    bool                                                mIsConcurrent;         // Pairs intersected in batches on the thread pool
+    int                                                 mNumIntersectedPairs;  // Pairs intersected by the batches so far
+    std::vector<std::vector<OffsetCurveIntersection> > mPairIntersections;    // Indexed the same as mCurvePairs
+
+    bool                             mIsAnalytic; // Closed-form intersections, no offset curves created
+    AcArray<OffsetCurveIntersection> mAnalyticIntersections;
+    double                           mBasePeriod[2]; // Closed form: 2*PI for circles and ellipses, 0.0 for lines
+    CurveKind                        mCurveKind[2];
+    OffsetIntersectionKernel         mClosedFormKernel; // Chosen once for the kinds of the two curves
+};
+    
+
+AcDbOffsetCurveIntersectionIter::AcDbOffsetCurveIntersectionIter(const AcGeCurve3d*  curve[2],
+                                                                 const AcGeVector3d& normal, 
+                                                                 double              offsetDist,
+                                                                 bool                offsetLeft[2],
+                                                                 const AcGeTol&      tol)
+  : mOffsetDist(offsetDist), mIsInitialized(false), mNormal(normal), mTol(tol), mPreferredCurvePair(-1, -1), mIsConcurrent(false), mNumIntersectedPairs(0), mIsAnalytic(false)
+{
+    mCurve[0] = curve[0];
+    mCurve[1] = curve[1];
+    mOffsetLeft[0] = offsetLeft[0];
+    mOffsetLeft[1] = offsetLeft[1];
+    mBaseCurve[0] = mBaseCurve[1] = nullptr;
+    mCurrentCurvePairIndex = 0;
+    mCurrentIntersectionIndex = -1; // The intersection object is not initialized
+    mBasePeriod[0] = mBasePeriod[1] = 0.0;
+    mCurveKind[0] = getCurveKind(curve[0]);
+    mCurveKind[1] = getCurveKind(curve[1]);
+    mClosedFormKernel = getOffsetIntersectionKernel(mCurveKind[0], mCurveKind[1]);
+}
+
+
+void AcDbOffsetCurveIntersectionIter::setAnalytic()
+{
+    mIsAnalytic = true;
+    mCurrentIntersectionIndex = 0;
+    for (int i = 0; i < 2; i++)
+    {
+        mBasePeriod[i] = mCurveKind[i] == kArcCurve || mCurveKind[i] == kEllipseCurve ? 2*M_PI : 0.0;
+    }
+}
+
+
+void AcDbOffsetCurveIntersectionIter::initialize()
+{
+    mIsInitialized = true;
+
+    if (mClosedFormKernel(mCurve, mNormal, mOffsetDist, mOffsetLeft, mTol, mAnalyticIntersections))
+    {
+        setAnalytic();
+        return;
+    }
+
+    // For zero radius (associative trim) the "offset" curves are the unbounded
+    // base curves themselves, so they are intersected directly, without calling
+    // getTrimmedOffset() and without splitting composite curves
+    //
+    for (int i = 0; i < 2; i++)
+    {
+        mOffsetCurveSet[i] = sOffsetCurveCache.getOffsetCurves(mCurve[i], mNormal, mOffsetLeft[i] ? mOffsetDist : -mOffsetDist, mTol);
+        mBaseCurve[i] = mOffsetCurveSet[i]->baseCurve();
+        for (int j = 0; j < mOffsetCurveSet[i]->offsetCurves().length(); j++)
+        {
+            mOffsetCurves[i].append(mOffsetCurveSet[i]->offsetCurves()[j]);
+        }
+    }
+
+    // Broad phase, only the overlapping pairs get to the exact curve-curve intersection
+    //
+    getOverlappingBoxPairs(mOffsetCurveSet[0]->offsetCurveBoxes(), mOffsetCurveSet[1]->offsetCurveBoxes(), mCurvePairs);
+
+    // Move the pair that gave the intersection in the previous evaluation to the front, 
+    // the other pairs stay in their order
+    //
+    const std::vector<std::pair<int, int> >::iterator preferred = std::find(mCurvePairs.begin(), mCurvePairs.end(), mPreferredCurvePair);
+    if (preferred != mCurvePairs.end())
+    {
+        std::rotate(mCurvePairs.begin(), preferred, preferred + 1);
+    }
+
+    if (AssocFilletConfig::intersectionThreadCount() > 1 && mCurvePairs.size() > 1)
+    {
+        mIsConcurrent        = true;
+        mNumIntersectedPairs = 0;
+        mPairIntersections.assign(mCurvePairs.size(), std::vector<OffsetCurveIntersection>());
+    }
+}
+
+
+// AcGeCurveCurveInt3d classifies the crossings using the tolerance, so near-tangent
+// crossings may be reported either way. The transversal crossings are classified
+// again by the exact orientation of the tangents of the offset curves, however
+// close to parallel they are. Only exactly parallel tangents keep the AcGe
+// configuration. The tangential configurations are kept, they match any 
+// mIntersCrossingType
+//
+static void classifyOffsetCurveCrossing(const AcGeCurve3d&  offsetCurve0,
+                                        const AcGeCurve3d&  offsetCurve1,
+                                        const double        param[2],
+                                        const AcGeVector3d& normal,
+                                        AcGe::AcGeXConfig   config[2])
+{
+    if (config[0] != AcGe::kLeftRight && config[0] != AcGe::kRightLeft)
+        return;
+
+    AcGeVector3dArray derivs;
+    AcGeVector3d      tangent[2];
+    offsetCurve0.evalPoint(param[0], 1, derivs);
+    tangent[0] = derivs[0];
+    derivs.removeAll();
+    offsetCurve1.evalPoint(param[1], 1, derivs);
+    tangent[1] = derivs[0];
+    getCrossingConfig(normal, tangent, config);
+}
+
+
+void AcDbOffsetCurveIntersectionIter::intersectNextCurvePairBatch()
+{
+    // A few pairs per thread, so that the batches are worth the synchronization
+    // but the caller can still stop early on curves with many sub-curves
+    //
+    const int kPairsPerThread = 4;
+    const int numThreads      = AssocFilletConfig::intersectionThreadCount();
+    const int firstPairIndex  = mNumIntersectedPairs;
+    const int endPairIndex    = __min(firstPairIndex + numThreads*kPairsPerThread, (int)mCurvePairs.size());
+
+    // The copies are made here on the calling thread, so that no AcGe object is
+    // used by more than one thread at the same time
+    //
+    std::vector<std::shared_ptr<AcGeCurve3d> > curveCopies[2];
+    for (int i = 0; i < 2; i++)
+    {
+        curveCopies[i].resize(endPairIndex - firstPairIndex);
+    }
+    for (int k = firstPairIndex; k < endPairIndex; k++)
+    {
+        curveCopies[0][k - firstPairIndex].reset(static_cast<AcGeCurve3d*>(mOffsetCurves[0][mCurvePairs[k].first]->copy()));
+        curveCopies[1][k - firstPairIndex].reset(static_cast<AcGeCurve3d*>(mOffsetCurves[1][mCurvePairs[k].second]->copy()));
+    }
+
+    // Each thread intersects every numThreads-th pair of the batch and stores
+    // the results at the index of the pair, so the result does not depend on 
+    // the timing
+    //
+    const AcGeVector3d normal = mNormal;
+    const AcGeTol      tol    = mTol;
+    std::vector<std::vector<OffsetCurveIntersection> >& pairIntersections = mPairIntersections;
+    const std::function<void(int)> intersectPairs = [&](int threadIndex)
+    {
+        AcGeCurveCurveInt3d curveCurveInters;
+        for (int k = firstPairIndex + threadIndex; k < endPairIndex; k += numThreads)
+        {
+            const AcGeCurve3d& offsetCurve0 = *curveCopies[0][k - firstPairIndex];
+            const AcGeCurve3d& offsetCurve1 = *curveCopies[1][k - firstPairIndex];
+            curveCurveInters.set(offsetCurve0, offsetCurve1, normal, tol);
+            std::vector<OffsetCurveIntersection>& intersections = pairIntersections[k];
+            intersections.resize(curveCurveInters.numIntPoints());
+            for (int n = 0; n < curveCurveInters.numIntPoints(); n++)
+            {
+                intersections[n].mPoint = curveCurveInters.intPoint(n);
+                curveCurveInters.getIntParams (n, intersections[n].mParam[0],  intersections[n].mParam[1]);
+                curveCurveInters.getIntConfigs(n, intersections[n].mConfig[0], intersections[n].mConfig[1]);
+                classifyOffsetCurveCrossing(offsetCurve0, offsetCurve1, intersections[n].mParam, normal, intersections[n].mConfig);
+            }
+        }
+    };
+
+    // If the pool was resized in the meantime or is busy with another evaluation,
+    // the calling thread does the whole batch
+    //
+    if (numThreads != sIntersectionThreadPool.numWorkers() + 1 || !sIntersectionThreadPool.run(intersectPairs))
+    {
+        for (int threadIndex = 0; threadIndex < numThreads; threadIndex++)
+        {
+            intersectPairs(threadIndex);
+        }
+    }
+    mNumIntersectedPairs = endPairIndex;
+}
+
+
+AcDbOffsetCurveIntersectionIter::~AcDbOffsetCurveIntersectionIter()
+{
+}
+
+
+bool AcDbOffsetCurveIntersectionIter::getNext(AcGePoint3d&      intersPoint, 
+                                              double            param[2], 
+                                              AcGe::AcGeXConfig config[2])
+{
+    if (!mIsInitialized)
+        initialize();
+
+    if (mIsAnalytic)
+    {
+        if (mCurrentIntersectionIndex >= mAnalyticIntersections.length())
+            return false;
+        const OffsetCurveIntersection& inters = mAnalyticIntersections[mCurrentIntersectionIndex++];
+        intersPoint = inters.mPoint;
+        param[0]    = inters.mParam[0];
+        param[1]    = inters.mParam[1];
+        config[0]   = inters.mConfig[0];
+        config[1]   = inters.mConfig[1];
+        return true;
+    }
+
+    if (mIsConcurrent)
+    {
+        for (; mCurrentCurvePairIndex < (int)mCurvePairs.size(); mCurrentCurvePairIndex++)
+        {
+            if (mCurrentCurvePairIndex >= mNumIntersectedPairs)
+                intersectNextCurvePairBatch();
+            const std::vector<OffsetCurveIntersection>& intersections = mPairIntersections[mCurrentCurvePairIndex];
+            if (mCurrentIntersectionIndex == -1)
+                mCurrentIntersectionIndex = 0;
+            if (mCurrentIntersectionIndex < (int)intersections.size())
+            {
+                const OffsetCurveIntersection& inters = intersections[mCurrentIntersectionIndex++];
+                intersPoint = inters.mPoint;
+                param[0]    = inters.mParam[0];
+                param[1]    = inters.mParam[1];
+                config[0]   = inters.mConfig[0];
+                config[1]   = inters.mConfig[1];
+                return true;
+            }
+            mCurrentIntersectionIndex = -1;
+        }
+        return false;
+    }
+
+    for (; mCurrentCurvePairIndex < (int)mCurvePairs.size(); mCurrentCurvePairIndex++)
+    {
+        if (mCurrentIntersectionIndex == -1) // Not initalized
+        {
+            mCurrentCurveCurveInters.set(*mOffsetCurves[0][mCurvePairs[mCurrentCurvePairIndex].first], 
+                                         *mOffsetCurves[1][mCurvePairs[mCurrentCurvePairIndex].second],
+                                         mNormal, 
+                                         mTol);
+            mCurrentIntersectionIndex = 0;
+        }
+
+        if (mCurrentIntersectionIndex < mCurrentCurveCurveInters.numIntPoints())
+        {
+            // Return the current intersection and advance to the next one
+            //
+            intersPoint = mCurrentCurveCurveInters.intPoint(mCurrentIntersectionIndex);
+            mCurrentCurveCurveInters.getIntParams(mCurrentIntersectionIndex, param[0], param[1]);
+            mCurrentCurveCurveInters.getIntConfigs(mCurrentIntersectionIndex, config[0], config[1]);
+            classifyOffsetCurveCrossing(*mOffsetCurves[0][mCurvePairs[mCurrentCurvePairIndex].first], 
+                                        *mOffsetCurves[1][mCurvePairs[mCurrentCurvePairIndex].second],
+                                        param,
+                                        mNormal,
+                                        config);
+            mCurrentIntersectionIndex++;
+            return true;
+        }
+        else
+        {
+            // All intersections used up. Mark the intersection not initialized, 
+            // so that it is initialized with next curves on the next cycle of the loop
+            //
+            mCurrentIntersectionIndex = -1; 
+        }
+    }
+    return false; // All intersections returned
+}
+
+
+void AcDbOffsetCurveIntersectionIter::resetToBaseCurves(const AcGeCurve3d* curve[2])
+{
+    const bool wasInitialized = mIsInitialized;
+    mIsInitialized = true;
+    mCurrentCurvePairIndex = 0;
+    mCurrentIntersectionIndex = -1;
+
+    // The offsets may have been intersected on windows of the given curves,
+    // e.g. on a few spans of a spline, but the base curves are the given ones
+    //
+    bool isCurveChanged = false;
+    for (int i = 0; i < 2; i++)
+    {
+        if (curve[i] != mCurve[i])
+        {
+            isCurveChanged = true;
+            mCurve[i]      = curve[i];
+            mCurveKind[i]  = getCurveKind(curve[i]);
+            mBaseCurve[i]  = nullptr;
+            mOffsetCurveSet[i].reset();
+        }
+    }
+    if (isCurveChanged)
+        mClosedFormKernel = getOffsetIntersectionKernel(mCurveKind[0], mCurveKind[1]);
+
+    if (mIsAnalytic || !wasInitialized || isCurveChanged)
+    {
+        const bool noOffset[2] = { false, false, };
+        if (mClosedFormKernel(curve, mNormal, 0.0, noOffset, mTol, mAnalyticIntersections))
+        {
+            setAnalytic();
+            return;
+        }
+        mIsAnalytic = false; // E.g. tangential base curves, use the general intersection
+    }
+
+    for (int i = 0; i < 2; i++)
+    {
+        if (mBaseCurve[i] == nullptr)
+        {
+            mOffsetCurveSet[i] = sOffsetCurveCache.getOffsetCurves(curve[i], mNormal, 0.0, mTol);
+            mBaseCurve[i] = mOffsetCurveSet[i]->baseCurve();
+        }
+        mOffsetCurves[i].removeAll();
+        mOffsetCurves[i].append(mBaseCurve[i]);
+        prepareCurve(mBaseCurve[i], mTol, mPreparedBaseCurve[i]);
+    }
+    mCurvePairs.assign(1, std::make_pair(0, 0));
+    mIsConcurrent = false;
+    mPairIntersections.clear();
+}
+
+
+void AcDbOffsetCurveIntersectionIter::setPreferredCurvePair(int index0, int index1)
+{
+    VERIFY(!mIsInitialized);
+    mPreferredCurvePair = std::make_pair(index0, index1);
+}
+
+
+bool AcDbOffsetCurveIntersectionIter::getCurrentCurvePair(int& index0, int& index1) const
+{
+    if (mIsAnalytic || mCurrentCurvePairIndex >= (int)mCurvePairs.size())
+        return false;
+
+    index0 = mCurvePairs[mCurrentCurvePairIndex].first;
+    index1 = mCurvePairs[mCurrentCurvePairIndex].second;
+    return true;
+}
+
+
+double AcDbOffsetCurveIntersectionIter::baseParamDistance(int index, double param0, double param1) const
+{
+    if (!mIsAnalytic)
+        return paramDistance(mPreparedBaseCurve[index], param0, param1);
+
+    // Closed-form case, the unbounded base curve is an infinite line, a full circle or a full ellipse
+    //
+    const AcGeInterval fullCircle(0.0, 2*M_PI);
+    return paramDistance(mBasePeriod[index] != 0.0, fullCircle, mBasePeriod[index], param0, param1);
+}
+
+
+// Evaluates the point on the offset of the curve at the given parameter, the
+// derivative of the offset curve, and the tangent of the curve itself
+//
+static bool evalOffsetPoint(const AcGeCurve3d*  pCurve, 
+                            const AcGeVector3d& normal, 
+                            double              offsetDist, // Positive = left, negative = right
+                            double              param,
+                            const AcGeTol&      tol,
+                            AcGePoint3d&        offsetPoint,
+                            AcGeVector3d&       offsetDeriv,
+                            AcGeVector3d&       tangent)
+{
+    AcGeVector3dArray derivs;
+    const AcGePoint3d pnt = pCurve->evalPoint(param, 2, derivs);
+    if (derivs.length() < 2)
+        return false;
+
+    // The offset direction is the unit vector of w = normal x tangent
+    //
+    tangent = derivs[0];
+    const AcGeVector3d w  = normal.crossProduct(derivs[0]);
+    const AcGeVector3d dw = normal.crossProduct(derivs[1]);
+    const double wLength = w.length();
+    if (wLength <= tol.equalVector())
+        return false;
+
+    offsetPoint = pnt + (offsetDist / wLength) * w;
+    offsetDeriv = derivs[0] + (offsetDist / wLength) * (dw - (w.dotProduct(dw) / (wLength * wLength)) * w);
+    return true;
+}
+
+
+// Brings the tracked parameter to the parameter range the offset curve intersection 
+// would return it in. Returns false if the parameter is outside of a non-periodic spline
+//
+static bool normalizeTrackedParam(const PreparedCurve& curve, const AcGeTol& tol, double& param)
+{
+    if (curve.mIsLinear)
+        return true; // Unbounded line
+
+    if (curve.mType == AcGe::kCircArc3d || curve.mType == AcGe::kEllipArc3d)
+    {
+        param = fmod(param, 2*M_PI); // Unbounded circle or ellipse goes from 0 to 2*PI
+        if (param < 0.0)
+            param += 2*M_PI;
+        return true;
+    }
+
+    const AcGeInterval& interval = curve.mInterval;
+    const double        period   = curve.mPeriod;
+    if (period > 0.0 && interval.isBoundedBelow())
+    {
+        param = interval.lowerBound() + fmod(param - interval.lowerBound(), period);
+        if (param < interval.lowerBound())
+            param += period;
+        return true;
+    }
+
+    // The iteration converges within the point tolerance, so the intersection
+    // at the very end of the spline may come out just outside of it
+    //
+    AcGeInterval tolInterval = interval;
+    tolInterval.setTolerance(tol.equalPoint());
+    return tolInterval.contains(param);
+}
+
+
+// Parameter distance that corresponds to the given length along the curve around 
+// the given parameter. The parameters of arcs, ellipses and splines are not 
+// lengths, so a point tolerance cannot be compared with parameter distances
+//
+static double getParamDistanceOfLength(const AcGeCurve3d* pCurve, double param, double length, const AcGeTol& tol)
+{
+    AcGeVector3dArray derivs;
+    pCurve->evalPoint(param, 1, derivs);
+    const double speed = derivs.length() > 0 ? derivs[0].length() : 0.0;
+    return speed > tol.equalVector() ? length / speed : 0.0;
+}
+
+
+static bool isTrackableCurve(const PreparedCurve& curve)
+{
+    return curve.mIsLinear                    || 
+           curve.mType == AcGe::kCircArc3d    || 
+           curve.mType == AcGe::kEllipArc3d   || 
+           curve.mType == AcGe::kNurbCurve3d;
+}
+
+
+// Tracks the intersection of the two offset curves from the parameters of the 
+// previous evaluation, without enumerating all intersections. It Newton-iterates
+// the system offsetPoint0(param0) == offsetPoint1(param1) where offsetPoint(param)
+// is curve(param) + offsetDist*unit(normal x tangent(param)).
+//
+// The result is only returned if the iteration converges, the offset curves are
+// regular (not in a trimmed-away loop) at the intersection, and the intersection 
+// has the expected crossing configuration. Also returns the parameter distance of
+// the intersection from the start parameters. Whether there may be a closer
+// intersection is decided by isSingleOffsetIntersection()
+//
+static bool trackOffsetIntersection(const PreparedCurve curve[2],
+                                    const AcGeVector3d& normal,
+                                    double              offsetDist,
+                                    const bool          offsetLeft[2],
+                                    int                 intersCrossingType,
+                                    const double        startParam[2],
+                                    const AcGeTol&      tol,
+                                    AcGePoint3d&        intersPoint,
+                                    double              param[2],
+                                    double&             paramDist)
 {
-    pUnboundedBaseCurve = nullptr;
-    offsetCurves.removeAll();
+    const int kMaxIterations = 20;
 
-    pUnboundedBaseCurve = getUnboundedCurve(pCurve);
+    const double signedOffsetDist[2] = { offsetLeft[0] ? offsetDist : -offsetDist, 
+                                         offsetLeft[1] ? offsetDist : -offsetDist, };
+    param[0] = startParam[0];
+    param[1] = startParam[1];
 
-    AcGeVoidPointerArray offsetCurvesVoid;
-    pUnboundedBaseCurve->getTrimmedOffset(radius, normal, offsetCurvesVoid, AcGe::kExtend);
+    AcGePoint3d  offsetPoint[2];
+    AcGeVector3d offsetDeriv[2];
+    AcGeVector3d tangent[2];
+    bool         isConverged = false;
 
-    for (int i = 0; i < offsetCurvesVoid.length(); i++)
+    for (int iteration = 0; iteration < kMaxIterations && !isConverged; iteration++)
     {
-        if (!VERIFY(static_cast<const AcGeEntity3d*>(offsetCurvesVoid[i])->isKindOf(AcGe::kCurve3d)))
-            continue;
-        AcGeCurve3d* const pOffsetCurve = static_cast<AcGeCurve3d*>(offsetCurvesVoid[i]);
-
-        AcGeVoidPointerArray simpleOffsetCurves;
-        if (pOffsetCurve->isKindOf(AcGe::kCompositeCrv3d))
+        for (int i = 0; i < 2; i++)
         {
-            static_cast<AcGeCompositeCurve3d*>(offsetCurvesVoid[i])->getCurveList(simpleOffsetCurves);
+            if (!evalOffsetPoint(curve[i].mpCurve, normal, signedOffsetDist[i], param[i], tol, offsetPoint[i], offsetDeriv[i], tangent[i]))
+                return false;
         }
-        else
+        const AcGeVector3d residual = offsetPoint[0] - offsetPoint[1];
+        if (residual.length() <= tol.equalPoint())
         {
-            simpleOffsetCurves.append(pOffsetCurve);
+            isConverged = true;
+            break;
         }
 
-        for (int i = 0; i < simpleOffsetCurves.length(); i++)
-        {
-            offsetCurves.append(static_cast<AcGeCurve3d*>(simpleOffsetCurves[i]));
-        }
+        // Least-squares Newton step for the Jacobian [offsetDeriv0, -offsetDeriv1]
+        //
+        const AcGeVector3d& a = offsetDeriv[0];
+        const AcGeVector3d  b = -offsetDeriv[1];
+        const double aa = a.dotProduct(a), ab = a.dotProduct(b), bb = b.dotProduct(b);
+        const double aF = a.dotProduct(residual), bF = b.dotProduct(residual);
+        const double det = aa * bb - ab * ab;
+        if (fabs(det) <= tol.equalVector() * aa * bb)
+            return false; // Tangential offset curves
+
+        param[0] += (ab * bF - bb * aF) / det;
+        param[1] += (ab * aF - aa * bF) / det;
+    }
+    if (!isConverged)
+        return false;
+
+    paramDist = 0.0;
+    for (int i = 0; i < 2; i++)
+    {
+        // The offset curve runs backwards where the offset distance exceeds the radius
+        // of curvature. Such parts are trimmed away from the trimmed offset curves
+        //
+        if (offsetDeriv[i].dotProduct(tangent[i]) <= 0.0)
+            return false;
+
+        if (!normalizeTrackedParam(curve[i], tol, param[i]))
+            return false;
+        paramDist += paramDistance(curve[i], param[i], startParam[i]);
     }
+
+    AcGe::AcGeXConfig config[2];
+    if (!getCrossingConfig(normal, tangent, config))
+        return false; // Tangential, needs the full classification
+    if ((config[0] == AcGe::kLeftRight ? 1 : 0) != intersCrossingType)
+        return false;
+
+    intersPoint = offsetPoint[0];
+    return true;
 }
-    
 
-static AcGeVector3d getCurveNormal(const AcGeCurve3d* pCurve)
+
+// Wraps an angle between two undirected tangents to (-PI/2, PI/2]
+//
+static double wrapHalfTurn(double angle)
+{
+    angle = fmod(angle, M_PI);
+    if (angle > M_PI/2)
+        angle -= M_PI;
+    else if (angle <= -M_PI/2)
+        angle += M_PI;
+    return angle;
+}
+
+
+// Brings a parameter sampled around the start parameter of a tracked intersection 
+// to where the curve is defined. Circles and ellipses are evaluated as unbounded
+// curves, the same as their offsets are intersected
+//
+static double getSampleParam(const PreparedCurve& curve, double param)
 {
-    AcGePlane plane;
-    if (pCurve->isKindOf(AcGe::kCircArc3d))
-        return ((AcGeCircArc3d*) pCurve)->normal();
-    else  if (pCurve->isKindOf(AcGe::kEllipArc3d))
-        return ((AcGeEllipArc3d*) pCurve)->normal();
-    else  if (pCurve->isPlanar(plane))
-        return plane.normal();  // Arbitrary normal, not good
-    return AcGeVector3d::kZAxis;
+    if (curve.mType == AcGe::kCircArc3d || curve.mType == AcGe::kEllipArc3d)
+        return param;
+    if (!curve.mInterval.isBounded())
+        return param;
+
+    const double lowerBound = curve.mInterval.lowerBound();
+    const double upperBound = curve.mInterval.upperBound();
+    if (curve.mIsClosed)
+    {
+        const double period = curve.mPeriod > 0.0 ? curve.mPeriod : upperBound - lowerBound;
+        param = lowerBound + fmod(param - lowerBound, period);
+        if (param < lowerBound)
+            param += period;
+        return param;
+    }
+    return AssocFilletGeometry::maxValue(lowerBound, AssocFilletGeometry::minValue(param, upperBound));
 }
 
 
-static AcGeVector3d getCurveNormal(const AcGeCurve3d* curve[2])
+// Returns the range of the directions of the offset curve tangents, as angles
+// around the normal, over the parameters within paramRadius of centerParam. 
+// The angles are walked from centerParam outwards, so they do not wrap. Returns
+// false if the offset curve is not regular somewhere in the range
+//
+static bool getOffsetTangentCone(const PreparedCurve& curve,
+                                 const AcGeVector3d&  normal,
+                                 double               signedOffsetDist,
+                                 double               centerParam,
+                                 double               paramRadius,
+                                 const AcGeTol&       tol,
+                                 double&              minAngle,
+                                 double&              maxAngle)
 {
-    const bool isLinear0 = curve[0]->isKindOf(AcGe::kLinearEnt3d) != 0;
-    const bool isLinear1 = curve[1]->isKindOf(AcGe::kLinearEnt3d) != 0;
+    const int kNumSamples = 16; // On each side of centerParam
+
+    const AcGeVector3d xAxis = normal.perpVector().normal(tol);
+    const AcGeVector3d yAxis = normal.crossProduct(xAxis);
 
-    if (isLinear0 && isLinear1)
+    double maxStep   = 0.0;
+    double baseAngle = 0.0;
+    minAngle = maxAngle = 0.0;
+
+    for (int side = -1; side <= 1; side += 2)
     {
-        const AcGeLinearEnt3d* const pLine0 = (const AcGeLinearEnt3d*)curve[0];
-        const AcGeLinearEnt3d* const pLine1 = (const AcGeLinearEnt3d*)curve[1];
-        const AcGeVector3d vec0 = pLine0->direction().normalize();
-        const AcGeVector3d vec1 = pLine1->direction().normalize();
-        AcGeVector3d normal;
-        if (vec0.isCodirectionalTo(vec1))
-        {
-            const AcGePoint3d pnt0 = pLine0->pointOnLine();
-            const AcGePoint3d pnt1 = pLine1->closestPointTo(pnt0);
-            normal = vec0.crossProduct(pnt1 - pnt0);
-        }
-        else
+        double angle = 0.0;
+        for (int k = 0; k <= kNumSamples; k++)
         {
-            normal = vec0.crossProduct(vec1);
+            AcGePoint3d  offsetPoint;
+            AcGeVector3d offsetDeriv;
+            AcGeVector3d tangent;
+            const double param = getSampleParam(curve, centerParam + side * paramRadius * k / kNumSamples);
+            if (!evalOffsetPoint(curve.mpCurve, normal, signedOffsetDist, param, tol, offsetPoint, offsetDeriv, tangent) ||
+                offsetDeriv.dotProduct(tangent) <= 0.0)
+            {
+                return false;
+            }
+            const double sampleAngle = atan2(offsetDeriv.dotProduct(yAxis), offsetDeriv.dotProduct(xAxis));
+            if (k == 0)
+            {
+                if (side == -1)
+                    baseAngle = sampleAngle;
+            }
+            else
+            {
+                const double step = wrapHalfTurn(sampleAngle - baseAngle - angle);
+                angle  += step;
+                maxStep = AssocFilletGeometry::maxValue(maxStep, fabs(step));
+            }
+            minAngle = AssocFilletGeometry::minValue(minAngle, angle);
+            maxAngle = AssocFilletGeometry::maxValue(maxAngle, angle);
         }
-        if (!normal.isZeroLength())
-            normal.normalize();
-        else
-            normal = AcGeVector3d::kZAxis;
-        return normal;
     }
-    else if (isLinear0)
-    {
-        return getCurveNormal(curve[1]);
-    }
-    else
+
+    // The tangent may turn a bit further between the samples
+    //
+    minAngle += baseAngle - maxStep;
+    maxAngle += baseAngle + maxStep;
+    return true;
+}
+
+
+// Returns true if the offsets of the two curves intersect at most once for the
+// parameters within maxParamDist of startParam, so that no intersection closer
+// to startParam than maxParamDist can exist besides the tracked one.
+//
+// If two regular curves intersect twice, each of them has a tangent parallel to
+// the chord between the two intersections. Therefore it is enough that the cones
+// of the tangent directions of the two offset curves, taken as undirected lines,
+// do not overlap over the parameter ranges
+//
+static bool isSingleOffsetIntersection(const PreparedCurve curve[2],
+                                       const AcGeVector3d& normal,
+                                       double              offsetDist,
+                                       const bool          offsetLeft[2],
+                                       const double        startParam[2],
+                                       double              maxParamDist,
+                                       const AcGeTol&      tol)
+{
+    double coneCenter[2];
+    double coneHalfAngle[2];
+    for (int i = 0; i < 2; i++)
     {
-        return getCurveNormal(curve[0]);
+        double minAngle = 0.0, maxAngle = 0.0;
+        if (!getOffsetTangentCone(curve[i], normal, offsetLeft[i] ? offsetDist : -offsetDist, startParam[i], maxParamDist, tol, minAngle, maxAngle))
+            return false;
+        coneCenter   [i] = (minAngle + maxAngle) / 2;
+        coneHalfAngle[i] = (maxAngle - minAngle) / 2;
     }
+    return coneHalfAngle[0] + coneHalfAngle[1] < fabs(wrapHalfTurn(coneCenter[0] - coneCenter[1]));
 }
 
 
-static void getCurveParamRange(const AcGeCurve3d* pCurve, bool& isClosed, AcGeInterval& paramInterval, double& paramPeriod)
+// Returns a copy of a long non-periodic spline hard-trimmed to the knot spans 
+// around the given parameter, numSpans spans on each side, with the same 
+// parameterization as the spline. Also returns the interior of the window, 
+// i.e. the window without its first and last span unless they end the spline.
+// An intersection found outside of the interior may be cut by the window, or 
+// there may be a closer one outside of the window.
+//
+// Returns nullptr if the curve is not a spline, or the window would cover the
+// whole spline. The interior is then unbounded
+//
+static AcGeCurve3d* getSplineWindow(const AcGeCurve3d* pCurve, double param, int numSpans, AcGeInterval& interior)
 {
-    isClosed = false;
-    pCurve->getInterval(paramInterval);
-    paramPeriod = 0.0;
+    interior = AcGeInterval();
 
-    if (!VERIFY(pCurve != nullptr))
-        return;
+    if (!pCurve->isKindOf(AcGe::kNurbCurve3d))
+        return nullptr;
+    const AcGeNurbCurve3d* const pNurb = static_cast<const AcGeNurbCurve3d*>(pCurve);
+    double period = 0.0;
+    if (pNurb->isPeriodic(period))
+        return nullptr; // The window might need to go over the seam
 
-    AcGePoint3d p0, p1;
-    isClosed = pCurve->isPeriodic(paramPeriod) || 
-               pCurve->isClosed()              || 
-               pCurve->hasStartPoint(p0) && pCurve->hasEndPoint(p1) && p0.isEqualTo(p1);
+    AcGeInterval interval;
+    pNurb->getInterval(interval);
+    AcGeDoubleArray knots;
+    pNurb->knots().getDistinctKnots(knots);
+
+    // Distinct knots inside of the curve interval
+    //
+    AcGeDoubleArray spanEnds;
+    for (int i = 0; i < knots.length(); i++)
+    {
+        if (knots[i] > interval.lowerBound() && knots[i] < interval.upperBound())
+            spanEnds.append(knots[i]);
+    }
+    spanEnds.insertAt(0, interval.lowerBound());
+    spanEnds.append(interval.upperBound());
+
+    const int numCurveSpans = spanEnds.length() - 1;
+    if (numCurveSpans <= 2 * numSpans + 1)
+        return nullptr;
+
+    int span = 0;
+    while (span < numCurveSpans - 1 && param >= spanEnds[span + 1])
+        span++;
+
+    const int firstSpan = __max(span - numSpans, 0);
+    const int lastSpan  = __min(span + numSpans, numCurveSpans - 1);
+    if (firstSpan == 0 && lastSpan == numCurveSpans - 1)
+        return nullptr;
+
+    if (firstSpan > 0)
+        interior.setLower(spanEnds[firstSpan + 1]);
+    if (lastSpan < numCurveSpans - 1)
+        interior.setUpper(spanEnds[lastSpan]);
+
+    AcGeNurbCurve3d* const pWindow = new AcGeNurbCurve3d(*pNurb);
+    pWindow->hardTrimByParams(spanEnds[firstSpan], spanEnds[lastSpan + 1]);
+    return pWindow;
 }
 
 
-// Takes into account that the curve may be periodic or closed, and returns the
-// shortest distance that may happen to be over the seam or end of the curve
+// Where a window returned by getCompositeWindow() lies on its composite curve
+//
+struct CompositeWindow
+{
+    CompositeWindow() : mFirstSegment(0), mNumSegments(0), mNumCurveSegments(0) { mIsCut[0] = mIsCut[1] = false; }
+
+    int  mFirstSegment;     // Segment of the composite curve that is the first segment of the window
+    int  mNumSegments;      // Number of segments of the window, 0 if there is no window
+    int  mNumCurveSegments; // Number of segments of the whole composite curve
+    bool mIsCut[2];         // The window has been cut from the rest of the curve at its first and last segment
+};
+
+
+// Returns a composite curve made of the segments of a long composite curve that 
+// are around the segment closest to the given point, numSegments segments on 
+// each side. The window of a closed composite curve may go over its start.
+//
+// The segment closest to the point is usually the one given by segmentHint, i.e. 
+// the segment the previous fillet arc touched, and then the other segments are
+// not looked at. Otherwise all the segments are searched.
+//
+// The window is parameterized by its own segments, use getCompositeParamOfWindowParam()
+// to get the parameters on the composite curve.
+//
+// Returns nullptr if the curve is not a composite curve, or the window would
+// cover the whole curve
 //
-static double paramDistance(const AcGeCurve3d* pCurve, double param0, double param1)
+static AcGeCurve3d* getCompositeWindow(const AcGeCurve3d* pCurve, const AcGePoint3d& nearPoint, int numSegments, int segmentHint, 
+                                       const AcGeTol& tol, CompositeWindow& window)
 {
-    bool isClosed = false;
-    AcGeInterval paramInterval;
-    double paramPeriod = 0.0;
-    getCurveParamRange(pCurve, isClosed, paramInterval, paramPeriod);
+    window = CompositeWindow();
 
-    double minDist = fabs(param1 - param0);
+    if (!pCurve->isKindOf(AcGe::kCompositeCrv3d))
+        return nullptr;
+    AcGeVoidPointerArray segments;
+    static_cast<const AcGeCompositeCurve3d*>(pCurve)->getCurveList(segments);
 
-    if (paramPeriod != 0.0)
-    {
-        param0 = fmod(param0 + 2*paramPeriod, paramPeriod);
-        param1 = fmod(param1 + 2*paramPeriod, paramPeriod);
+    const int numCurveSegments = segments.length();
+    if (numCurveSegments <= 2 * numSegments + 1)
+        return nullptr;
 
-        minDist = __min(minDist, fabs(param0 - param1 + paramPeriod));
-        minDist = __min(minDist, fabs(param1 - param0 + paramPeriod));
+    int nearestSegment = -1;
+    if (segmentHint >= 0 && segmentHint < numCurveSegments &&
+        static_cast<const AcGeCurve3d*>(segments[segmentHint])->distanceTo(nearPoint, tol) <= tol.equalPoint())
+    {
+        nearestSegment = segmentHint; // The point is still on the same segment
     }
-    else if (isClosed)
+    else
     {
-        // Closed curve (the start and end point coincide)
-        //
-        double fromParam = paramInterval.lowerBound();
-        double toParam   = paramInterval.upperBound();
+        double minDist = 1e30;
+        for (int i = 0; i < numCurveSegments; i++)
+        {
+            const double dist = static_cast<const AcGeCurve3d*>(segments[i])->distanceTo(nearPoint, tol);
+            if (dist < minDist)
+            {
+                minDist        = dist;
+                nearestSegment = i;
+            }
+        }
+    }
+
+    const bool isClosed     = pCurve->isClosed(tol) != 0;
+    int        firstSegment = nearestSegment - numSegments;
+    int        lastSegment  = nearestSegment + numSegments;
+    if (!isClosed)
+    {
+        firstSegment = __max(firstSegment, 0);
+        lastSegment  = __min(lastSegment, numCurveSegments - 1);
+    }
 
-        minDist = __min(minDist, fabs(param0 - fromParam) + fabs(param1 - toParam));
-        minDist = __min(minDist, fabs(param1 - fromParam) + fabs(param0 - toParam));
+    AcGeVoidPointerArray windowSegments;
+    for (int i = firstSegment; i <= lastSegment; i++)
+    {
+        windowSegments.append(segments[(i + numCurveSegments) % numCurveSegments]);
     }
-    return minDist;
+
+    window.mFirstSegment     = (firstSegment + numCurveSegments) % numCurveSegments;
+    window.mNumSegments      = lastSegment - firstSegment + 1;
+    window.mNumCurveSegments = numCurveSegments;
+    window.mIsCut[0]         = isClosed || firstSegment > 0;
+    window.mIsCut[1]         = isClosed || lastSegment  < numCurveSegments - 1;
+    return new AcGeCompositeCurve3d(windowSegments); // Copies the segments
 }
 
 
-// Iterates over all intersections of the offsets of the two given curves
+// Returns the index in the composite curve of the given segment of its window,
+// -1 if the segment is -1
 //
-class AcDbOffsetCurveIntersectionIter
+static int getCurveSegmentOfWindowSegment(const CompositeWindow& window, int windowSegment)
 {
-public:
-    AcDbOffsetCurveIntersectionIter(const AcGeCurve3d*  curve[2],
-                                    const AcGeVector3d& normal, 
-                                    double              offsetDist,
-                                    bool                offsetLeft[2]);
-    ~AcDbOffsetCurveIntersectionIter();
-
-    // Returns the next intersection point between the two offset curves.
-    // Also returns parametric position of the intersection. The parameterization
-    // of the offset curves seems to match parameterization of the original curves,
-    // therefore the parametric position is on the original curves at the closest
-    // point to the offset curve intersection
-    //
-    bool getNext(AcGePoint3d&      intersPoint,
-                 double            param[2],   
-                 AcGe::AcGeXConfig config[2]);
+    return windowSegment >= 0 ? (window.mFirstSegment + windowSegment) % window.mNumCurveSegments : -1;
+}
 
-private:
-    AcGeCurve3d*          mBaseCurve[2];
-    AcArray<AcGeCurve3d*> mOffsetCurves[2];
-    AcGeVector3d          mNormal;
-    AcGeCurveCurveInt3d   mCurrentCurveCurveInters;
-    int                   mCurrentCurveIndex[2];
-    int                   mCurrentIntersectionIndex;
-};
-    
 
-AcDbOffsetCurveIntersectionIter::AcDbOffsetCurveIntersectionIter(const AcGeCurve3d*  curve[2],
-                                                                 const AcGeVector3d& normal, 
-                                                                 double              offsetDist,
-                                                                 bool                offsetLeft[2])
-  : mNormal(normal)
+// Returns the parameter on the composite curve of the point at the given parameter
+// of its window. The window segments are copies of the curve segments, so the
+// local parameter on the segment is the same. Also returns the index of the 
+// segment in the window
+//
+static double getCompositeParamOfWindowParam(const AcGeCurve3d*     pCurve, 
+                                             const AcGeCurve3d*     pWindow, 
+                                             const CompositeWindow& window, 
+                                             double                 windowParam,
+                                             int&                   windowSegment)
 {
-    mBaseCurve[0] = mBaseCurve[1] = nullptr;
-    mCurrentCurveIndex[0] = mCurrentCurveIndex[1] = 0;
-    mCurrentIntersectionIndex = -1; // The intersection object is not initialized
+    windowSegment = 0;
+    const double localParam = static_cast<const AcGeCompositeCurve3d*>(pWindow)->globalToLocalParam(windowParam, windowSegment);
+    return static_cast<const AcGeCompositeCurve3d*>(pCurve)->localToGlobalParam(localParam, getCurveSegmentOfWindowSegment(window, windowSegment));
+}
 
-    getUnbooundedOffsetCurves(curve[0], normal, offsetLeft[0] ? offsetDist : -offsetDist, mBaseCurve[0], mOffsetCurves[0]); 
-    getUnbooundedOffsetCurves(curve[1], normal, offsetLeft[1] ? offsetDist : -offsetDist, mBaseCurve[1], mOffsetCurves[1]);
+
+// Replaces the parameters of the intersection on the windows of composite curves
+// by the parameters on the composite curves, see getCompositeParamOfWindowParam().
+// Returns the segments of the windows, -1 for the curves that have no window
+//
+static void getCompositeParamsOfWindowParams(const AcGeCurve3d*    curve[2], 
+                                             const AcGeCurve3d*    windowCurve[2], 
+                                             const CompositeWindow window[2], 
+                                             double                param[2],
+                                             int                   windowSegment[2])
+{
+    for (int i = 0; i < 2; i++)
+    {
+        windowSegment[i] = -1;
+        if (window[i].mNumSegments > 0)
+            param[i] = getCompositeParamOfWindowParam(curve[i], windowCurve[i], window[i], param[i], windowSegment[i]);
+    }
 }
 
 
-AcDbOffsetCurveIntersectionIter::~AcDbOffsetCurveIntersectionIter()
+// Number of evaluations rejected by isFilletFeasible()
+//
+static std::atomic<Adesk::UInt64> sNumInfeasibleFillets(0);
+
+// Number of evaluations that took the tracked intersection without enumerating
+//
+static std::atomic<Adesk::UInt64> sNumTrackedIntersections(0);
+
+
+// Rejects in constant time the fillets that cannot exist, before any offset 
+// curve is created or intersected:
+//
+//  - Parallel lines, whose offsets never cross
+//  - A circular arc or ellipse offset to its inside by more than its (minor) radius
+//  - Concentric circular arcs
+//  - Offsets that are too far apart to intersect
+//
+// Only lines, circular arcs and ellipses are checked, for other curves the
+// fillet is assumed to be feasible. Returns true if the fillet may be feasible
+//
+static bool isFilletFeasible(const AcGeCurve3d*  curve[2], 
+                             const AcGeVector3d& normal, 
+                             double              offsetDist, 
+                             const bool          offsetLeft[2], 
+                             const AcGeTol&      tol)
 {
+    PlanarConic conic[2];
     for (int i = 0; i < 2; i++)
     {
-        for (int j = 0; j < mOffsetCurves[i].length(); j++)
-            delete mOffsetCurves[i][j];
-        mOffsetCurves[i].removeAll();
-        delete mBaseCurve[i];
+        if (!getPlanarConic(curve[i], normal, tol, conic[i]))
+            return true;
+    }
+    const double signedOffsetDist[2] = { offsetLeft[0] ? offsetDist : -offsetDist, 
+                                         offsetLeft[1] ? offsetDist : -offsetDist, };
+
+    // Largest distance of the offset of a circle or ellipse from its center, and for 
+    // a circle also the smallest one, which is the same
+    //
+    double maxOffsetRadius[2] = { 0.0, 0.0, };
+    double minOffsetRadius[2] = { 0.0, 0.0, };
+    for (int i = 0; i < 2; i++)
+    {
+        if (conic[i].mIsLine)
+            continue;
+
+        const double inwardDist = signedOffsetDist[i] * conic[i].mLeftSide; // Positive towards the center
+        const double minRadius  = __min(conic[i].mRadius[0], conic[i].mRadius[1]);
+        const double maxRadius  = __max(conic[i].mRadius[0], conic[i].mRadius[1]);
+        if (inwardDist > minRadius + tol.equalPoint())
+            return false; // The inner offset does not exist
+        if (conic[i].mRadius[0] == conic[i].mRadius[1] && inwardDist >= minRadius - tol.equalPoint())
+            return false; // The offset circle collapses to the center
+
+        maxOffsetRadius[i] = maxRadius - inwardDist;
+        minOffsetRadius[i] = conic[i].mRadius[0] == conic[i].mRadius[1] ? maxOffsetRadius[i] : 0.0;
+    }
+
+    if (conic[0].mIsLine && conic[1].mIsLine)
+    {
+        const AcGeVector3d& v0 = conic[0].mXAxis;
+        const AcGeVector3d& v1 = conic[1].mXAxis;
+        return fabs(normal.dotProduct(v0.crossProduct(v1))) > tol.equalVector() * v0.length() * v1.length();
+    }
+    else if (conic[0].mIsLine || conic[1].mIsLine)
+    {
+        const int iLine  = conic[0].mIsLine ? 0 : 1;
+        const int iConic = 1 - iLine;
+        const AcGePoint3d offsetOrigin = conic[iLine].mCenter + signedOffsetDist[iLine] * conic[iLine].mYAxis;
+        const double centerDist = fabs((conic[iConic].mCenter - offsetOrigin).dotProduct(conic[iLine].mYAxis));
+        return centerDist <= maxOffsetRadius[iConic] + tol.equalPoint();
+    }
+
+    const AcGeVector3d c0c1 = conic[1].mCenter - conic[0].mCenter;
+    const double centerDist = (c0c1 - c0c1.dotProduct(normal) * normal).length();
+    if (centerDist > maxOffsetRadius[0] + maxOffsetRadius[1] + tol.equalPoint())
+        return false;
+    if (minOffsetRadius[0] > 0.0 && minOffsetRadius[1] > 0.0) // Both are circles
+    {
+        if (centerDist <= tol.equalPoint())
+            return false; // Concentric
+        if (centerDist < fabs(minOffsetRadius[0] - minOffsetRadius[1]) - tol.equalPoint())
+            return false; // One offset circle inside of the other one
     }
+    return true;
 }
 
 
-bool AcDbOffsetCurveIntersectionIter::getNext(AcGePoint3d&      intersPoint, 
-                                              double            param[2], 
-                                              AcGe::AcGeXConfig config[2])
+// Returns false if the intersection last returned by the iterator lies on the
+// offset of the first or last segment of a composite curve window that has been
+// cut there. Such an intersection may be an artefact of the cut, or there may 
+// be a better one outside of the window. For zero radius the window is intersected
+// as a whole, and the segment is given by windowSegment
+//
+static bool isInCompositeWindowInterior(const AcDbOffsetCurveIntersectionIter& iter, 
+                                        const CompositeWindow                  window[2], 
+                                        const int                              windowSegment[2])
 {
-    for (; mCurrentCurveIndex[0] < mOffsetCurves[0].length(); mCurrentCurveIndex[0]++)
+    int        curvePair[2] = { 0, 0, };
+    const bool haveCurvePair = iter.getCurrentCurvePair(curvePair[0], curvePair[1]);
+
+    for (int i = 0; i < 2; i++)
     {
-        for (; mCurrentCurveIndex[1] < mOffsetCurves[1].length(); mCurrentCurveIndex[1]++)
-        {
-            if (mCurrentIntersectionIndex == -1) // Not initalized
-            {
-                mCurrentCurveCurveInters.set(*mOffsetCurves[0][mCurrentCurveIndex[0]], 
-                                             *mOffsetCurves[1][mCurrentCurveIndex[1]],
-                                             mNormal);
-                mCurrentIntersectionIndex = 0;
-            }
+        if (window[i].mNumSegments == 0)
+            continue;
 
-            if (mCurrentIntersectionIndex < mCurrentCurveCurveInters.numIntPoints())
-            {
-                // Return the current intersection and advance to the next one
-                //
-                intersPoint = mCurrentCurveCurveInters.intPoint(mCurrentIntersectionIndex);
-                mCurrentCurveCurveInters.getIntParams(mCurrentIntersectionIndex, param[0], param[1]);
-                mCurrentCurveCurveInters.getIntConfigs(mCurrentIntersectionIndex, config[0], config[1]);
-                mCurrentIntersectionIndex++;
-                return true;
-            }
-            else
-            {
-                // All intersections used up. Mark the intersection not initialized, 
-                // so that it is initialized with next curves on the next cycle of the loop
-                //
-                mCurrentIntersectionIndex = -1; 
-            }
+        int index      = windowSegment[i];
+        int numIndices = window[i].mNumSegments;
+        if (haveCurvePair && iter.numOffsetCurves(i) > 1)
+        {
+            index      = curvePair[i];
+            numIndices = iter.numOffsetCurves(i);
+        }
+        if (window[i].mIsCut[0] && index == 0 || 
+            window[i].mIsCut[1] && index == numIndices - 1)
+        {
+            return false;
         }
-        mCurrentCurveIndex[1] = 0; // Outer loop will advance, inner loop needs to start from to beginning
     }
-    return false; // All intersections returned
+    return true;
 }
 
 
@@ -307,6 +2769,8 @@ AssocFilletConfig::AssocFilletConfig()
 {
     mIsIncoming[0] = mIsIncoming[1] = true;
     mParam[0] = mParam[1] = 0.0;
+    mCurvePairHint[0] = mCurvePairHint[1] = -1;
+    mWindowSegmentHint[0] = mWindowSegmentHint[1] = -1;
 }
     
 
@@ -318,14 +2782,31 @@ void AssocFilletConfig::setPickPoints(const AcGePoint3d  pickPoint[2])
 }
 
 
+void AssocFilletConfig::setConfiguration(const bool isIncoming[2], int intersCrossingType)
+{
+    mIsIncoming[0]        = isIncoming[0];
+    mIsIncoming[1]        = isIncoming[1];
+    mIntersCrossingType   = intersCrossingType;
+    mParam[0] = mParam[1] = 0.0;
+    mHaveIntersPoint      = false;
+    mIsInitialized        = true;
+    mCurvePairHint[0]     = mCurvePairHint[1]     = -1;
+    mWindowSegmentHint[0] = mWindowSegmentHint[1] = -1;
+}
+
+
 ErrorStatus AssocFilletConfig::initializeFromPickPoints(const AcGeCurve3d* curve[2], 
-                                                        double             radius)
+                                                        double             radius,
+                                                        const AcGeTol&     tol)
 {
     if (!VERIFY(curve[0] != nullptr && curve[1] != nullptr))
         return eInvalidInput;
 
-    AcGeTolSetter relaxedTol;
-    const AcGeVector3d normal = getCurveNormal(curve);
+    PreparedCurve preparedCurve[2];
+    prepareCurve(curve[0], tol, preparedCurve[0]);
+    prepareCurve(curve[1], tol, preparedCurve[1]);
+
+    const AcGeVector3d normal = getCurveNormal(preparedCurve, tol);
     if (normal.length() < 0.5)
         return Acad::eInvalidNormal;
 
@@ -333,59 +2814,100 @@ ErrorStatus AssocFilletConfig::initializeFromPickPoints(const AcGeCurve3d* curve
     for (int i = 0; i < 2; i++)
     {
         AcGePointOnCurve3d pointOnCurve;
-        curve[i]->getClosestPointTo(mPickPoint[1-i], pointOnCurve);
+        curve[i]->getClosestPointTo(mPickPoint[1-i], pointOnCurve, tol);
         const AcGeVector3d vec = normal.crossProduct(pointOnCurve.deriv(1));
         offsetLeft[i] = vec.dotProduct(mPickPoint[1-i]-pointOnCurve.point()) > 0.0;
     }
 
     // Iterate over all intersection points between the two offset curves and 
-    // find the one that is closest to the pick points
+    // find the one that is closest to the pick points. Long composite curves are
+    // only offset around the segment closest to the pick point, the same way 
+    // evaluate() does it around the previous fillet arc
     //
-    AcDbOffsetCurveIntersectionIter iter(curve, normal, radius, offsetLeft);
+    const int kInitialWindowSegments = 4;
 
     double            minDist = 1e30;
     AcGePoint3d       intersPnt;
     double            param[2] = { 0.0, 0.0, };
     AcGe::AcGeXConfig config[2];
 
-    while (iter.getNext(intersPnt, param, config))
+    std::auto_ptr<AcGeCurve3d> pWindowCurve[2];
+    int                        numWindowSegments = kInitialWindowSegments;
+    bool                       isWindowed        = false;
+
+    do
     {
-        const double dist = intersPnt.distanceTo(mPickPoint[0]) + intersPnt.distanceTo(mPickPoint[1]);
-        if (dist < minDist)
+        const AcGeCurve3d* windowCurve[2] = { curve[0], curve[1], };
+        CompositeWindow    compositeWindow[2];
+        isWindowed = false;
+        for (int i = 0; i < 2; i++)
         {
-            // Compute directionToArc pointing in the direction to the fillet arc 
-            // curve for determining if curves are incoming into the fillet arc
-            //
-            AcGeVector3d       directionToArc;  // The sum of two direction vectors
-            AcGePointOnCurve3d pointOnCurve[2]; // Points where the fillet arc touches the curves
+            pWindowCurve[i].reset(getCompositeWindow(curve[i], mPickPoint[i], numWindowSegments, -1, tol, compositeWindow[i]));
+            if (pWindowCurve[i].get() != nullptr)
+            {
+                windowCurve[i] = pWindowCurve[i].get();
+                isWindowed     = true;
+            }
+        }
+        numWindowSegments *= 4;
 
-            for (int i = 0; i < 2; i++)
+        AcDbOffsetCurveIntersectionIter iter(windowCurve, normal, radius, offsetLeft, tol);
+
+        while (iter.getNext(intersPnt, param, config))
+        {
+            int windowSegment[2];
+            getCompositeParamsOfWindowParams(curve, windowCurve, compositeWindow, param, windowSegment);
+
+            const double dist = intersPnt.distanceTo(mPickPoint[0]) + intersPnt.distanceTo(mPickPoint[1]);
+            if (dist < minDist && isInCompositeWindowInterior(iter, compositeWindow, windowSegment))
             {
-                curve[i]->getClosestPointTo(intersPnt, pointOnCurve[i]);
-                if (radius != 0.0)
+                // Compute directionToArc pointing in the direction to the fillet arc 
+                // curve for determining if curves are incoming into the fillet arc
+                //
+                AcGeVector3d       directionToArc;  // The sum of two direction vectors
+                AcGePointOnCurve3d pointOnCurve[2]; // Points where the fillet arc touches the curves
+
+                for (int i = 0; i < 2; i++)
                 {
-                    directionToArc += (pointOnCurve[i].point() - intersPnt).normal(); 
+                    curve[i]->getClosestPointTo(intersPnt, pointOnCurve[i], tol);
+                    if (radius != 0.0)
+                    {
+                        directionToArc += (pointOnCurve[i].point() - intersPnt).normal(tol); 
+                    }
+                    else
+                    {
+                        directionToArc += (intersPnt - mPickPoint[i]).normal(tol);
+                    }
                 }
-                else
+                for (int i = 0; i < 2; i++)
                 {
-                    directionToArc += (intersPnt - mPickPoint[i]).normal();
+                    mIsIncoming[i] = directionToArc.dotProduct(pointOnCurve[i].deriv(1)) > 0.0;
                 }
-            }
-            for (int i = 0; i < 2; i++)
-            {
-                mIsIncoming[i] = directionToArc.dotProduct(pointOnCurve[i].deriv(1)) > 0.0;
-            }
-            if (setIntersectionCrossingType(config) != eOk)
-                continue;
+                if (setIntersectionCrossingType(config) != eOk)
+                    continue;
 
-            mParam[0] = param[0];
-            mParam[1] = param[1];
-            minDist   = dist;
+                mParam[0] = param[0];
+                mParam[1] = param[1];
+                minDist   = dist;
+                if (!iter.getCurrentCurvePair(mCurvePairHint[0], mCurvePairHint[1]))
+                {
+                    mCurvePairHint[0] = mCurvePairHint[1] = -1;
+                }
+                mWindowSegmentHint[0] = getCurveSegmentOfWindowSegment(compositeWindow[0], windowSegment[0]);
+                mWindowSegmentHint[1] = getCurveSegmentOfWindowSegment(compositeWindow[1], windowSegment[1]);
+            }
         }
-    }
+    } while (minDist > 1e29 && isWindowed);
+
     if (minDist > 1e29)
         return eInvalidInput; // No intersection point found
 
+    // The first evaluate() windows the composite curves around the fillet arc end
+    // points, which are not known yet, use the points at the chosen parameters
+    //
+    mArcEndPoint[0] = curve[0]->evalPoint(mParam[0]);
+    mArcEndPoint[1] = curve[1]->evalPoint(mParam[1]);
+
     mIsInitialized = true;
     return eOk; 
 }
@@ -409,7 +2931,7 @@ ErrorStatus AssocFilletConfig::setIntersectionCrossingType(AcGe::AcGeXConfig con
         {
             mIntersCrossingType = mIsIncoming[0] && !mIsIncoming[1] ? 1 : 0;
         }
-        else  if (config[2] == AcGe::kRightRight)
+        else  if (config[1] == AcGe::kRightRight)
         {
             mIntersCrossingType = mIsIncoming[0] && mIsIncoming[1] ? 1 : 0;
         }
@@ -435,11 +2957,11 @@ ErrorStatus AssocFilletConfig::setIntersectionCrossingType(AcGe::AcGeXConfig con
 }
 
 
-void AssocFilletConfig::adjustTweakedLine(int index, AcGeCurve3d* pCurve) const
+void AssocFilletConfig::adjustTweakedLine(int index, AcGeCurve3d* pCurve, const AcGeTol& tol) const
 {
     if (!VERIFY(pCurve != nullptr))
         return;
-    if (!(pCurve->isKindOf(AcGe::kLineSeg3d)))
+    if (pCurve->type() != AcGe::kLineSeg3d)
         return;
     if (!mHaveIntersPoint)
         return; // Cannot use the intersection point of the input curves because it does not exist
@@ -462,9 +2984,9 @@ void AssocFilletConfig::adjustTweakedLine(int index, AcGeCurve3d* pCurve) const
     const AcGeVector3d toTouchPointVector  = touchPoint   - otherPoint;
     const AcGeVector3d toIntersPointVector = mIntersPoint - otherPoint;
 
-    if (touchPoint.isEqualTo(mArcEndPoint[index])             && 
-        !toTouchPointVector.isParallelTo(toIntersPointVector) &&
-        !toIntersPointVector.isZeroLength())
+    if (touchPoint.isEqualTo(mArcEndPoint[index], tol)            && 
+        !toTouchPointVector.isParallelTo(toIntersPointVector, tol) &&
+        !toIntersPointVector.isZeroLength(tol))
     {
         // The changed input curve (line segment) has the point that touches 
         // the fillet arc unchanged, but the angle of the line changed. 
@@ -473,7 +2995,7 @@ void AssocFilletConfig::adjustTweakedLine(int index, AcGeCurve3d* pCurve) const
         // if the stretch or rotation were around the intersection of the infinite
         // line with the other curve, not around the touch point with the fillet arc
 
-        if (pLineSeg->startPoint().isEqualTo(touchPoint))
+        if (pLineSeg->startPoint().isEqualTo(touchPoint, tol))
         {
             pLineSeg->set(mIntersPoint, otherPoint);
         }
@@ -508,14 +3030,14 @@ ErrorStatus AssocFilletConfig::evaluate(bool           updateState,
                                         double         radius, 
                                         const bool     isTrimCurve[2],
                                         bool           adjustTweakedCurves,
-                                        AcGeCircArc3d& filletArcOut)
+                                        AcGeCircArc3d& filletArcOut,
+                                        const AcGeTol& tol)
 {
     filletArcOut = AcGeCircArc3d();
-    AcGeTolSetter relaxedTol;
 
     if (!isInitialized())
     {
-        initializeFromPickPoints(const_cast<const AcGeCurve3d**>(curve), radius);
+        initializeFromPickPoints(const_cast<const AcGeCurve3d**>(curve), radius, tol);
     }
 
     if (adjustTweakedCurves && radius != 0.0)
@@ -524,14 +3046,20 @@ ErrorStatus AssocFilletConfig::evaluate(bool           updateState,
         {
             if (isTrimCurve[i])
             {
-                adjustTweakedLine(i, curve[i]);
+                adjustTweakedLine(i, curve[i], tol);
             }
         }
     }
     if (!VERIFY(isInitialized()))
         return eNotInitializedYet; // It actually means "cannot be initialized"
 
-    const AcGeVector3d normal = getCurveNormal((const AcGeCurve3d**)curve);
+    // The curves are prepared after the tweaked lines have been adjusted
+    //
+    PreparedCurve preparedCurve[2];
+    prepareCurve(curve[0], tol, preparedCurve[0]);
+    prepareCurve(curve[1], tol, preparedCurve[1]);
+
+    const AcGeVector3d normal = getCurveNormal(preparedCurve, tol);
     if (normal.length() < 0.5)
         return eInvalidInput;
 
@@ -543,46 +3071,121 @@ ErrorStatus AssocFilletConfig::evaluate(bool           updateState,
         left[1] = !left[1];
     }
 
-    bool         isClosed[2] = { false, false, };
-    AcGeInterval paramInterval[2];
-    double       paramPeriod[2] = { 0.0, 0.0, };
-    getCurveParamRange(curve[0], isClosed[0], paramInterval[0], paramPeriod[0]);
-    getCurveParamRange(curve[1], isClosed[1], paramInterval[1], paramPeriod[1]);
+    if (!isFilletFeasible((const AcGeCurve3d**)curve, normal, radius, left, tol))
+    {
+        sNumInfeasibleFillets++;
+        return eInvalidInput;
+    }
 
-    // Find an intersection between the two offset curves that matches the configuration
+    // Find an intersection between the two offset curves that matches the configuration.
+    // A candidate this close to the previous parameters is taken without looking 
+    // at the remaining intersections
     //
-    AcDbOffsetCurveIntersectionIter iter((const AcGeCurve3d**)curve, normal, radius, left);
+    const double kMatchPointDist = 4 * tol.equalPoint();
+    const double matchParamDist  = getParamDistanceOfLength(curve[0], mParam[0], kMatchPointDist, tol) + 
+                                   getParamDistanceOfLength(curve[1], mParam[1], kMatchPointDist, tol);
+    AssocFilletGeometry::CandidateSelector<AcGeFilletTraits> selector(mIntersCrossingType, matchParamDist);
 
-    double      minParamDist = 1e30;
-    AcGePoint3d bestIntersPnt;
-    double      bestParam[2] = { 0.0, 0.0, };
+    int         bestCurvePair[2] = { mCurvePairHint[0], mCurvePairHint[1], };
+    int         bestSegment[2]   = { mWindowSegmentHint[0], mWindowSegmentHint[1], };
     AcGePoint3d intersPnt;
     double      param[2] = { 0.0, 0.0, };
     AcGe::AcGeXConfig config[2];
 
-    while (iter.getNext(intersPnt, param, config))
+    // Ellipses and splines have no closed-form offset intersection. The intersection
+    // is first tracked from the previous parameters. All the intersections of the
+    // offset curves are only enumerated if another intersection might be closer to
+    // the previous parameters than the tracked one, i.e. if enumeration might choose
+    // another one
+    //
+    const bool isTrackable = isTrackableCurve(preparedCurve[0]) && isTrackableCurve(preparedCurve[1]) &&
+                             (preparedCurve[0].mType == AcGe::kEllipArc3d || preparedCurve[0].mType == AcGe::kNurbCurve3d ||
+                              preparedCurve[1].mType == AcGe::kEllipArc3d || preparedCurve[1].mType == AcGe::kNurbCurve3d);
+    double trackedParamDist = 0.0;
+    bool   isTracked        = false;
+    if (isTrackable && isIntersectionTrackingEnabled() &&
+        trackOffsetIntersection(preparedCurve, normal, radius, left, mIntersCrossingType, mParam, 
+                                tol, intersPnt, param, trackedParamDist))
     {
-        // Check if configuration of this intersection point matches
-        //
-        if (mIntersCrossingType == 1 && config[0] == AcGe::kLeftRight || 
-            mIntersCrossingType == 0 && config[0] == AcGe::kRightLeft ||
-            config[0] == AcGe::kLeftLeft || config[0] == AcGe::kRightRight)
+        selector.offer(intersPnt, param, trackedParamDist);
+        isTracked = isSingleOffsetIntersection(preparedCurve, normal, radius, left, mParam, trackedParamDist, tol);
+        if (isTracked)
+            sNumTrackedIntersections++;
+    }
+
+    // Long splines are only offset over a window of knot spans around the previous 
+    // parameters, and long composite curves over a window of segments around the
+    // previous fillet arc end points. If no matching intersection is found inside 
+    // of the window, the window is widened, until it covers the whole curve
+    //
+    const int kInitialWindowSpans = 4;
+
+    std::auto_ptr<AcGeCurve3d>                     pWindowCurve[2];
+    std::auto_ptr<AcDbOffsetCurveIntersectionIter> pIter;
+    int                                            numWindowSpans = kInitialWindowSpans;
+    bool                                           isWindowed     = false;
+
+    if (!isTracked)
+    {
+        do
         {
-            const double paramDist0 = paramDistance(curve[0], param[0], mParam[0]);
-            const double paramDist1 = paramDistance(curve[1], param[1], mParam[1]);
-            const double paramDist  = paramDist0 + paramDist1;
-            if (paramDist < minParamDist)
+            const AcGeCurve3d* windowCurve[2] = { curve[0], curve[1], };
+            AcGeInterval       windowInterior[2];
+            CompositeWindow    compositeWindow[2];
+            isWindowed = false;
+            for (int i = 0; i < 2; i++)
+            {
+                pWindowCurve[i].reset(getSplineWindow(curve[i], mParam[i], numWindowSpans, windowInterior[i]));
+                if (pWindowCurve[i].get() == nullptr)
+                    pWindowCurve[i].reset(getCompositeWindow(curve[i], mArcEndPoint[i], numWindowSpans, mWindowSegmentHint[i], tol, compositeWindow[i]));
+                if (pWindowCurve[i].get() != nullptr)
+                {
+                    windowCurve[i] = pWindowCurve[i].get();
+                    isWindowed     = true;
+                }
+            }
+            numWindowSpans *= 4;
+
+            pIter.reset(new AcDbOffsetCurveIntersectionIter(windowCurve, normal, radius, left, tol));
+            pIter->setPreferredCurvePair(mCurvePairHint[0], mCurvePairHint[1]);
+
+            while (!selector.isDone() && pIter->getNext(intersPnt, param, config))
             {
-                minParamDist  = paramDist;
-                bestIntersPnt = intersPnt;
-                bestParam[0]  = param[0];
-                bestParam[1]  = param[1];
+                // Check if configuration of this intersection point matches
+                //
+                if (selector.isMatching(config[0]))
+                {
+                    int windowSegment[2];
+                    getCompositeParamsOfWindowParams((const AcGeCurve3d**)curve, windowCurve, compositeWindow, param, windowSegment);
+
+                    if (!windowInterior[0].contains(param[0]) || !windowInterior[1].contains(param[1]) ||
+                        !isInCompositeWindowInterior(*pIter, compositeWindow, windowSegment))
+                    {
+                        continue;
+                    }
+
+                    const double paramDist0 = paramDistance(preparedCurve[0], param[0], mParam[0]);
+                    const double paramDist1 = paramDistance(preparedCurve[1], param[1], mParam[1]);
+                    if (selector.offer(intersPnt, param, paramDist0 + paramDist1))
+                    {
+                        if (!pIter->getCurrentCurvePair(bestCurvePair[0], bestCurvePair[1]))
+                        {
+                            bestCurvePair[0] = bestCurvePair[1] = -1;
+                        }
+                        bestSegment[0] = getCurveSegmentOfWindowSegment(compositeWindow[0], windowSegment[0]);
+                        bestSegment[1] = getCurveSegmentOfWindowSegment(compositeWindow[1], windowSegment[1]);
+                    }
+                }
             }
-        }
+        } while (!selector.hasBest() && isWindowed);
     }
-    if (minParamDist > 1e29)
+
+    if (!selector.hasBest())
         return eInvalidInput; // No intersection point found
 
+    const AcGePoint3d bestIntersPnt = selector.bestPoint();
+    const double      bestParam[2]  = { selector.bestParam(0), selector.bestParam(1), };
+
     AcGePoint3d   arcEndPoint[2];
     AcGeCircArc3d filletArc;
 
@@ -597,38 +3200,31 @@ ErrorStatus AssocFilletConfig::evaluate(bool           updateState,
         AcGePointOnCurve3d pointOnCurve0, pointOnCurve1;
         arcEndPoint[0] = pointOnCurve0.point(*curve[0], bestParam[0]);
         arcEndPoint[1] = pointOnCurve1.point(*curve[1], bestParam[1]);
-        const AcGeVector3d vec0 = arcEndPoint[0] - bestIntersPnt;
-        const AcGeVector3d vec1 = arcEndPoint[1] - bestIntersPnt;
-        AcGeVector3d vec2 = vec0.crossProduct(vec1);
         AcGeVector3d arcRefVec;
         double arcAngle = 0.0;
-
-        if (vec2.isZeroLength())
-        {
-            // 180 degree arc (tangent intersection)
-            //
-            vec2 = pointOnCurve1.deriv(1);
-            if (!mIsIncoming[0])
-                vec2.negate();
-            vec2 = normal.crossProduct(vec2);
-            arcRefVec = vec2.dotProduct(vec1) > 0.0 ? vec1 : vec0;
-            arcAngle = M_PI;
-        }
-        else
-        {
-            // Regular case where arc angle is less than 180 degrees
-            //
-            arcRefVec = vec2.dotProduct(normal) > 0.0 ? vec0 : vec1;
-            arcAngle = vec0.angleTo(vec1);
-        }
+        AssocFilletGeometry::getFilletArc<AcGeFilletTraits>(bestIntersPnt, arcEndPoint[0], arcEndPoint[1], normal, 
+                                                            pointOnCurve1.deriv(1), mIsIncoming[0], tol.equalVector(), 
+                                                            arcRefVec, arcAngle);
               
         filletArc = AcGeCircArc3d(bestIntersPnt, normal, arcRefVec, radius, 0.0, arcAngle);
     }
 
+    // Find the intersection of the two (non-offset) curves in the same pass, before
+    // the curves are trimmed, reusing the unbounded curves created by the iterator
+    //
+    AcGePoint3d intersPoint;
+    bool        haveIntersPoint = false;
+    if (updateState && radius != 0.0)
+    {
+        if (pIter.get() == nullptr) // Tracked, nothing enumerated
+            pIter.reset(new AcDbOffsetCurveIntersectionIter((const AcGeCurve3d**)curve, normal, radius, left, tol));
+        haveIntersPoint = getIntersectionPoint(*pIter, (const AcGeCurve3d**)curve, bestParam, intersPoint) == eOk;
+    }
+
     // If requested, trim/extend the input curves to the fillet arc
     //
-    if ((isTrimCurve[0] && trimOrExtendCurve(curve[0], bestParam[0], mIsIncoming[0]) != eOk) ||
-        (isTrimCurve[1] && trimOrExtendCurve(curve[1], bestParam[1], mIsIncoming[1]) != eOk))
+    if ((isTrimCurve[0] && trimOrExtendCurve(curve[0], preparedCurve[0], bestParam[0], mIsIncoming[0], tol) != eOk) ||
+        (isTrimCurve[1] && trimOrExtendCurve(curve[1], preparedCurve[1], bestParam[1], mIsIncoming[1], tol) != eOk))
     {
         return eInvalidInput;
     }
@@ -639,6 +3235,10 @@ ErrorStatus AssocFilletConfig::evaluate(bool           updateState,
         //
         mParam[0] = bestParam[0];
         mParam[1] = bestParam[1];
+        mCurvePairHint[0] = bestCurvePair[0];
+        mCurvePairHint[1] = bestCurvePair[1];
+        mWindowSegmentHint[0] = bestSegment[0];
+        mWindowSegmentHint[1] = bestSegment[1];
 
         if (radius == 0.0)
         {
@@ -648,7 +3248,9 @@ ErrorStatus AssocFilletConfig::evaluate(bool           updateState,
         {
             mArcEndPoint[0] = arcEndPoint[0];
             mArcEndPoint[1] = arcEndPoint[1];
-            mHaveIntersPoint = getIntersectionPoint((const AcGeCurve3d**)curve, mIntersPoint) == eOk;
+            mHaveIntersPoint = haveIntersPoint;
+            if (mHaveIntersPoint)
+                mIntersPoint = intersPoint;
         }
     }
     filletArcOut = filletArc;
@@ -656,71 +3258,440 @@ ErrorStatus AssocFilletConfig::evaluate(bool           updateState,
 }
 
 
-ErrorStatus AssocFilletConfig::trimOrExtendCurve(AcGeCurve3d* pCurve, double param, bool isIncoming)
+ErrorStatus AssocFilletConfig::trimOrExtendCurve(AcGeCurve3d*         pCurve, 
+                                                 const PreparedCurve& prepared, // Of the curve before it is trimmed
+                                                 double               param, 
+                                                 bool                 isIncoming, 
+                                                 const AcGeTol&       tol)
 {
-    bool         isClosed = false;
-    AcGeInterval paramInterval;
-    double       paramPeriod = 0.0;
-    getCurveParamRange(pCurve, isClosed, paramInterval, paramPeriod);
+    AcGeInterval paramInterval = prepared.mInterval;
+    const double paramPeriod   = prepared.mPeriod;
 
     if (paramPeriod != 0.0)
         return eOk; // Doesn't make sense to trim periodic curves
 
+    double lowerBound = paramInterval.lowerBound();
+    double upperBound = paramInterval.upperBound();
+    if (!AssocFilletGeometry::trimParamRange(paramInterval.isBoundedBelow(), paramInterval.isBoundedAbove(), 
+                                             lowerBound, upperBound, param, isIncoming))
+    {
+        return eInvalidInput;
+    }
     if (isIncoming)
+        paramInterval.setUpper(upperBound);
+    else
+        paramInterval.setLower(lowerBound);
+
+    pCurve->setInterval(paramInterval);
+
+    AcGe::EntityId degenerateType;
+    if (pCurve->isDegenerate(degenerateType, tol))
+        return eInvalidInput;
+    return eOk;
+}
+
+
+ErrorStatus AssocFilletConfig::trimToLastFilletArc(AcGeCurve3d* curve[2], const bool isTrimCurve[2], const AcGeTol& tol) const
+{
+    if (!VERIFY(isInitialized()))
+        return eNotInitializedYet;
+
+    for (int i = 0; i < 2; i++)
     {
-        if (paramPeriod > 0.0)
+        if (isTrimCurve[i])
         {
-            if (param <= paramInterval.lowerBound())
-                param += paramPeriod;
+            if (!VERIFY(curve[i] != nullptr))
+                return eNullPtr;
+            PreparedCurve preparedCurve;
+            prepareCurve(curve[i], tol, preparedCurve);
+            const ErrorStatus err = trimOrExtendCurve(curve[i], preparedCurve, mParam[i], mIsIncoming[i], tol);
+            if (err != eOk)
+                return err;
         }
-        paramInterval.setUpper(param); 
     }
-    else
+    return eOk;
+}
+
+
+ErrorStatus AssocFilletConfig::getIntersectionPoint(AcDbOffsetCurveIntersectionIter& iter,
+                                                    const AcGeCurve3d*               curve[2], 
+                                                    const double                     param[2],
+                                                    AcGePoint3d&                     intersPoint) const
+{
+    intersPoint = AcGePoint3d::kOrigin;
+
+    if (!VERIFY(curve[0] != nullptr && curve[1] != nullptr))
+        return eNullPtr;
+
+    // Choose the intersection of the unbounded curves the same way a zero-radius 
+    // evaluation does, i.e. matching configuration closest to the given parameters
+    //
+    iter.resetToBaseCurves(curve);
+
+    double            minParamDist = 1e30;
+    AcGePoint3d       intersPnt;
+    double            intersParam[2] = { 0.0, 0.0, };
+    AcGe::AcGeXConfig config[2];
+
+    while (iter.getNext(intersPnt, intersParam, config))
     {
-        if (paramPeriod > 0.0)
+        if (AssocFilletGeometry::isMatchingCrossing<AcGeFilletTraits>(mIntersCrossingType, config[0]))
         {
-            if (param >= paramInterval.upperBound())
-                param -= paramPeriod;
+            const double paramDist = iter.baseParamDistance(0, intersParam[0], param[0]) + 
+                                     iter.baseParamDistance(1, intersParam[1], param[1]);
+            if (paramDist < minParamDist)
+            {
+                minParamDist = paramDist;
+                intersPoint  = intersPnt;
+            }
         }
-        paramInterval.setLower(param);
     }
-    if (paramInterval.isBoundedBelow() && 
-        paramInterval.isBoundedAbove() && 
-        paramInterval.lowerBound() >= paramInterval.upperBound())
+    return minParamDist > 1e29 ? eInvalidInput : eOk;
+}
+
+
+AcGeTol AssocFilletConfig::geomTolerance()
+{
+    AcGeTol tol;
+    tol.setEqualPoint (1e-6);
+    tol.setEqualVector(1e-10);
+    return tol;
+}
+
+
+Adesk::UInt64 AssocFilletConfig::numInfeasibleFillets()
+{
+    return sNumInfeasibleFillets;
+}
+
+
+void AssocFilletConfig::resetNumInfeasibleFillets()
+{
+    sNumInfeasibleFillets = 0;
+}
+
+
+Adesk::UInt64 AssocFilletConfig::numTrackedIntersections()
+{
+    return sNumTrackedIntersections;
+}
+
+
+void AssocFilletConfig::resetNumTrackedIntersections()
+{
+    sNumTrackedIntersections = 0;
+}
+
+
+void AssocFilletConfig::getOrientationStatistics(Adesk::UInt64& numFiltered, Adesk::UInt64& numExact)
+{
+    numFiltered = sNumFilteredOrientations;
+    numExact    = sNumExactOrientations;
+}
+
+
+void AssocFilletConfig::resetOrientationStatistics()
+{
+    sNumFilteredOrientations = 0;
+    sNumExactOrientations    = 0;
+}
+
+
+static std::atomic<bool> sIsIntersectionTrackingEnabled(true);
+
+
+void AssocFilletConfig::setIntersectionTrackingEnabled(bool yesNo)
+{
+    sIsIntersectionTrackingEnabled = yesNo;
+}
+
+
+bool AssocFilletConfig::isIntersectionTrackingEnabled()
+{
+    return sIsIntersectionTrackingEnabled;
+}
+
+
+void AssocFilletConfig::setIntersectionThreadCount(int numThreads)
+{
+    sIntersectionThreadPool.resize(__max(numThreads, 1) - 1);
+}
+
+
+int AssocFilletConfig::intersectionThreadCount()
+{
+    return sIntersectionThreadPool.numWorkers() + 1;
+}
+
+
+void AssocFilletConfig::setOffsetCurveCacheBudget(size_t memoryBudget)
+{
+    sOffsetCurveCache.setMemoryBudget(memoryBudget);
+}
+
+
+size_t AssocFilletConfig::offsetCurveCacheBudget()
+{
+    return sOffsetCurveCache.memoryBudget();
+}
+
+
+void AssocFilletConfig::getOffsetCurveCacheStatistics(Adesk::UInt64& hits, Adesk::UInt64& misses, size_t& memoryUsed)
+{
+    sOffsetCurveCache.getStatistics(hits, misses, memoryUsed);
+}
+
+
+void AssocFilletConfig::clearOffsetCurveCache()
+{
+    sOffsetCurveCache.clear();
+}
+
+
+// Creates the test curve with the given seed. The kind of the curve is given by
+// the seed, and the curves pass near the origin in random directions, so that 
+// most pairs of them can be filleted there. The same seed gives the same curve
+//
+static AcGeCurve3d* createTestCurve(unsigned seed)
+{
+    std::mt19937                           random(seed);
+    std::uniform_real_distribution<double> unit(-1.0, 1.0);
+
+    const double       angle = M_PI * unit(random);
+    const AcGeVector3d dir(cos(angle), sin(angle), 0.0);
+    const AcGeVector3d side = AcGeVector3d::kZAxis.crossProduct(dir);
+    const AcGePoint3d  nearPoint(0.2 * unit(random), 0.2 * unit(random), 0.0);
+
+    switch (seed % 5)
     {
-        return eInvalidInput;
+    case 0:
+        return new AcGeLineSeg3d(nearPoint - 10.0*dir, nearPoint + 10.0*dir);
+    case 1:
+        {
+            const double radius = 2.0 + unit(random);
+            return new AcGeCircArc3d(nearPoint + radius*side, AcGeVector3d::kZAxis, -side, radius, -1.5, 1.5);
+        }
+    case 2:
+        {
+            const double majorRadius = 3.0 + unit(random);
+            const double minorRadius = 1.5 + unit(random);
+            return new AcGeEllipArc3d(nearPoint + minorRadius*side, dir, -side, majorRadius, minorRadius);
+        }
+    case 3:
+        {
+            AcGeKnotVector   knots;
+            AcGePoint3dArray controlPoints;
+            const int        kNumKnots = 11;
+            const double     knotValues[kNumKnots] = { 0.0, 0.0, 0.0, 0.0, 1.0, 2.0, 3.0, 4.0, 4.0, 4.0, 4.0, };
+            for (int i = 0; i < kNumKnots; i++)
+                knots.append(knotValues[i]);
+            for (int i = 0; i < 7; i++)
+                controlPoints.append(nearPoint + (i - 3)*2.0*dir + unit(random)*side);
+            return new AcGeNurbCurve3d(3, knots, controlPoints);
+        }
+    default:
+        {
+            // Zigzag of line segments, long enough to be windowed by evaluate()
+            //
+            AcGeVoidPointerArray segments;
+            for (int i = 0; i < 16; i++)
+            {
+                const AcGePoint3d start = nearPoint + (i - 8)*1.5*dir + (i % 2 == 0 ? 0.2 : -0.2)*side;
+                const AcGePoint3d end   = nearPoint + (i - 7)*1.5*dir + (i % 2 == 0 ? -0.2 : 0.2)*side;
+                segments.append(new AcGeLineSeg3d(start, end));
+            }
+            AcGeCurve3d* const pComposite = new AcGeCompositeCurve3d(segments); // Copies the segments
+            for (int i = 0; i < segments.length(); i++)
+                delete static_cast<AcGeLineSeg3d*>(segments[i]);
+            return pComposite;
+        }
     }
+}
 
-    pCurve->setInterval(paramInterval);
 
-    AcGe::EntityId degenerateType;
-    if (pCurve->isDegenerate(degenerateType))
-        return eInvalidInput;
-    return eOk;
+static void appendTestPoint(std::vector<double>& results, const AcGePoint3d& point)
+{
+    results.push_back(point.x);
+    results.push_back(point.y);
+    results.push_back(point.z);
 }
 
 
-ErrorStatus AssocFilletConfig::getIntersectionPoint(const AcGeCurve3d* curve[2], 
-                                                    AcGePoint3d&       intersPoint) const
+static void appendTestResult(std::vector<double>& results, ErrorStatus err, const AcGeCircArc3d& filletArc, AcGeCurve3d* curve[2])
 {
-    intersPoint = AcGePoint3d::kOrigin;
+    results.push_back(err);
+    if (err != eOk)
+        return;
+    appendTestPoint(results, filletArc.center());
+    appendTestPoint(results, filletArc.startPoint());
+    appendTestPoint(results, filletArc.endPoint());
+    results.push_back(filletArc.radius());
+    for (int i = 0; i < 2; i++)
+    {
+        AcGePoint3d point;
+        if (curve[i]->hasStartPoint(point))
+            appendTestPoint(results, point);
+        if (curve[i]->hasEndPoint(point))
+            appendTestPoint(results, point);
+    }
+}
 
-    if (!VERIFY(curve[0] != nullptr && curve[1] != nullptr))
-        return eNullPtr;
 
-    AcGeCurve3d* pUnboundedCurve[2] = { getUnboundedCurve(curve[0]), getUnboundedCurve(curve[1]), };
-    std::auto_ptr<AcGeCurve3d> delete0(pUnboundedCurve[0]);
-    std::auto_ptr<AcGeCurve3d> delete1(pUnboundedCurve[1]);
+// Evaluates the test fillet with the given index like a short grip drag: from 
+// the pick points, and then again with a slightly changed radius starting from
+// the previous fillet, and appends all the results
+//
+static void evaluateTestFillet(int index, int numCurves, const AcGeTol& tol, std::vector<double>& results)
+{
+    std::mt19937                           random(index);
+    std::uniform_real_distribution<double> unit(-1.0, 1.0);
+
+    unsigned seed[2] = { (unsigned)(index % numCurves), (unsigned)((index * 7 + 1 + index / numCurves) % numCurves), };
+    if (seed[1] == seed[0])
+        seed[1] = (seed[1] + 1) % numCurves;
 
-    bool doNotTrimCurves[2] = { false, false, };
-    AcGeCircArc3d filletArc;
-    AssocFilletConfig config = *this;
-    ErrorStatus err = config.evaluate(false/*updateState*/, pUnboundedCurve, 0.0/*radius*/, doNotTrimCurves, false, filletArc);
-    if (err == eOk)
+    AcGePoint3d pickPoint[2];
+    {
+        std::auto_ptr<AcGeCurve3d> pCurve[2];
+        for (int i = 0; i < 2; i++)
+        {
+            pCurve[i].reset(createTestCurve(seed[i]));
+            pickPoint[i] = pCurve[i]->closestPointTo(AcGePoint3d(unit(random), unit(random), 0.0), tol);
+        }
+    }
+
+    AssocFilletConfig config;
+    config.setPickPoints(pickPoint);
+
+    const bool   isTrimCurve[2] = { true, true, };
+    const double radius         = 0.1 + 0.2 * (unit(random) + 1.0);
+    for (int step = 0; step < 2; step++)
     {
-        intersPoint = filletArc.center();
+        std::auto_ptr<AcGeCurve3d> pCurve[2];
+        pCurve[0].reset(createTestCurve(seed[0]));
+        pCurve[1].reset(createTestCurve(seed[1]));
+        AcGeCurve3d* curve[2] = { pCurve[0].get(), pCurve[1].get(), };
+
+        AcGeCircArc3d     filletArc;
+        const ErrorStatus err = config.evaluate(true, curve, radius * (1.0 + 0.05*step), isTrimCurve, false, filletArc, tol);
+        appendTestResult(results, err, filletArc, curve);
     }
-    return err;
+}
+
+
+int AssocFilletConfig::runConcurrentEvaluationTest(int numFillets, int numThreads, const AcGeTol& tol)
+{
+    // Fewer curves than fillets, so that the threads also use the same entries
+    // of the offset curve cache at the same time
+    //
+    const int numCurves = __max(numFillets / 8, 10);
+    numThreads = __max(numThreads, 1);
+
+    std::vector<std::vector<double> > serialResults    (numFillets);
+    std::vector<std::vector<double> > concurrentResults(numFillets);
+
+    clearOffsetCurveCache();
+    for (int k = 0; k < numFillets; k++)
+    {
+        evaluateTestFillet(k, numCurves, tol, serialResults[k]);
+    }
+
+    clearOffsetCurveCache();
+    const std::function<void(int)> evaluateFillets = [&](int threadIndex)
+    {
+        for (int k = threadIndex; k < numFillets; k += numThreads)
+        {
+            evaluateTestFillet(k, numCurves, tol, concurrentResults[k]);
+        }
+    };
+    std::vector<std::thread> threads;
+    for (int threadIndex = 0; threadIndex < numThreads; threadIndex++)
+    {
+        try
+        {
+            threads.push_back(std::thread(evaluateFillets, threadIndex));
+        }
+        catch (const std::system_error&)
+        {
+            evaluateFillets(threadIndex); // The thread could not be created, still concurrent with the others
+        }
+    }
+    for (size_t i = 0; i < threads.size(); i++)
+    {
+        threads[i].join();
+    }
+
+    int numDifferent = 0;
+    for (int k = 0; k < numFillets; k++)
+    {
+        if (serialResults[k].size() != concurrentResults[k].size() ||
+            !serialResults[k].empty() && 
+            memcmp(serialResults[k].data(), concurrentResults[k].data(), serialResults[k].size() * sizeof(double)) != 0)
+        {
+            numDifferent++;
+        }
+    }
+    return numDifferent;
+}
+
+
+// FNV-1a over the bytes of the doubles, 64-bit on all platforms
+//
+static Adesk::UInt64 getKeyHash(const std::vector<double>& key)
+{
+    Adesk::UInt64 hash = 14695981039346656037ULL;
+    const unsigned char* const pBytes = reinterpret_cast<const unsigned char*>(key.data());
+    const size_t numBytes = key.size() * sizeof(double);
+    for (size_t i = 0; i < numBytes; i++)
+    {
+        hash ^= pBytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+
+Adesk::UInt64 AssocFilletConfig::stateHash() const
+{
+    std::vector<double> key;
+    appendValue(key, mIsIncoming[0] ? 1.0 : 0.0);
+    appendValue(key, mIsIncoming[1] ? 1.0 : 0.0);
+    appendValue(key, mIntersCrossingType);
+    appendValue(key, mParam[0]);
+    appendValue(key, mParam[1]);
+    appendPoint(key, mArcEndPoint[0]);
+    appendPoint(key, mArcEndPoint[1]);
+    appendValue(key, mHaveIntersPoint ? 1.0 : 0.0);
+    if (mHaveIntersPoint)
+        appendPoint(key, mIntersPoint);
+    appendValue(key, mIsInitialized ? 1.0 : 0.0);
+    if (!mIsInitialized)
+    {
+        appendPoint(key, mPickPoint[0]);
+        appendPoint(key, mPickPoint[1]);
+    }
+    return getKeyHash(key);
+}
+
+
+bool AssocFilletConfig::getCurveHash(const AcGeCurve3d* pCurve, Adesk::UInt64& hash)
+{
+    hash = 0;
+    if (!VERIFY(pCurve != nullptr))
+        return false;
+
+    // The fingerprint of the offset curve cache leaves out the parameter range
+    // of lines and arcs, because their offsets are created unbounded
+    //
+    std::vector<double> key;
+    if (!appendCurveFingerprint(pCurve, key))
+        return false;
+    AcGeInterval interval;
+    pCurve->getInterval(interval);
+    appendInterval(key, interval);
+
+    hash = getKeyHash(key);
+    return true;
 }
 
 
@@ -764,6 +3735,123 @@ ErrorStatus AssocFilletConfig::dwgInFields(AcDbDwgFiler* pFiler)
         pFiler->readPoint3d(&mPickPoint[0]);
         pFiler->readPoint3d(&mPickPoint[1]);
     }
+    mCurvePairHint[0] = mCurvePairHint[1] = -1;
+    mWindowSegmentHint[0] = mWindowSegmentHint[1] = -1;
+    return pFiler->filerStatus();
+}
+
+
+static bool isSamePoint(const AcGePoint3d& pnt0, const AcGePoint3d& pnt1)
+{
+    return pnt0.x == pnt1.x && pnt0.y == pnt1.y && pnt0.z == pnt1.z;
+}
+
+
+unsigned AssocFilletConfig::getChangedFields(const AssocFilletConfig& other) const
+{
+    unsigned fields = 0;
+    if (mIsIncoming[0] != other.mIsIncoming[0] || mIsIncoming[1] != other.mIsIncoming[1])
+        fields |= kIsIncomingField;
+    if (mIntersCrossingType != other.mIntersCrossingType)
+        fields |= kIntersCrossingTypeField;
+    if (mParam[0] != other.mParam[0] || mParam[1] != other.mParam[1])
+        fields |= kParamField;
+    if (!isSamePoint(mArcEndPoint[0], other.mArcEndPoint[0]) || !isSamePoint(mArcEndPoint[1], other.mArcEndPoint[1]))
+        fields |= kArcEndPointField;
+    if (mHaveIntersPoint != other.mHaveIntersPoint || (mHaveIntersPoint && !isSamePoint(mIntersPoint, other.mIntersPoint)))
+        fields |= kIntersPointField;
+    if (mIsInitialized != other.mIsInitialized || 
+        (!mIsInitialized && (!isSamePoint(mPickPoint[0], other.mPickPoint[0]) || !isSamePoint(mPickPoint[1], other.mPickPoint[1]))))
+    {
+        fields |= kPickPointField;
+    }
+    return fields;
+}
+
+
+ErrorStatus AssocFilletConfig::dwgOutChangedFields(AcDbDwgFiler* pFiler, const AssocFilletConfig& other) const
+{
+    const unsigned fields = getChangedFields(other);
+
+    pFiler->writeUInt16((Adesk::UInt16)fields);
+    if (fields & kIsIncomingField)
+    {
+        pFiler->writeBool(mIsIncoming[0]);
+        pFiler->writeBool(mIsIncoming[1]);
+    }
+    if (fields & kIntersCrossingTypeField)
+    {
+        pFiler->writeInt32(mIntersCrossingType);
+    }
+    if (fields & kParamField)
+    {
+        pFiler->writeDouble(mParam[0]);
+        pFiler->writeDouble(mParam[1]);
+    }
+    if (fields & kArcEndPointField)
+    {
+        pFiler->writePoint3d(mArcEndPoint[0]);
+        pFiler->writePoint3d(mArcEndPoint[1]);
+    }
+    if (fields & kIntersPointField)
+    {
+        pFiler->writeBool(mHaveIntersPoint);
+        if (mHaveIntersPoint)
+            pFiler->writePoint3d(mIntersPoint);
+    }
+    if (fields & kPickPointField)
+    {
+        pFiler->writeBool(mIsInitialized);
+        if (!mIsInitialized)
+        {
+            pFiler->writePoint3d(mPickPoint[0]);
+            pFiler->writePoint3d(mPickPoint[1]);
+        }
+    }
+    return pFiler->filerStatus();
+}
+
+
+ErrorStatus AssocFilletConfig::dwgInChangedFields(AcDbDwgFiler* pFiler)
+{
+    Adesk::UInt16 fields = 0;
+    pFiler->readUInt16(&fields);
+    if (fields & kIsIncomingField)
+    {
+        pFiler->readBool(&mIsIncoming[0]);
+        pFiler->readBool(&mIsIncoming[1]);
+    }
+    if (fields & kIntersCrossingTypeField)
+    {
+        pFiler->readInt32((Int32*)(&mIntersCrossingType));
+    }
+    if (fields & kParamField)
+    {
+        pFiler->readDouble(&mParam[0]);
+        pFiler->readDouble(&mParam[1]);
+    }
+    if (fields & kArcEndPointField)
+    {
+        pFiler->readPoint3d(&mArcEndPoint[0]);
+        pFiler->readPoint3d(&mArcEndPoint[1]);
+    }
+    if (fields & kIntersPointField)
+    {
+        pFiler->readBool(&mHaveIntersPoint);
+        if (mHaveIntersPoint)
+            pFiler->readPoint3d(&mIntersPoint);
+    }
+    if (fields & kPickPointField)
+    {
+        pFiler->readBool(&mIsInitialized);
+        if (!mIsInitialized)
+        {
+            pFiler->readPoint3d(&mPickPoint[0]);
+            pFiler->readPoint3d(&mPickPoint[1]);
+        }
+    }
+    mCurvePairHint[0] = mCurvePairHint[1] = -1;
+    mWindowSegmentHint[0] = mWindowSegmentHint[1] = -1;
     return pFiler->filerStatus();
 }
 
@@ -791,6 +3879,9 @@ ErrorStatus AssocFilletConfig::dxfInFields(AcDbDxfFiler* pFiler)
     ErrorStatus  err = eOk;
     resbuf rb;
 
+    mCurvePairHint[0] = mCurvePairHint[1] = -1;
+    mWindowSegmentHint[0] = mWindowSegmentHint[1] = -1;
+
     while ((err = pFiler->readResBuf(&rb)) == eOk)
     {
         switch (rb.restype) 
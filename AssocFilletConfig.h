@@ -18,6 +18,9 @@
 #include "dbmain.h"
 #pragma pack (push, 8)
 
+class AcDbOffsetCurveIntersectionIter;
+struct PreparedCurve;
+
 // The center of a fillet arc is the point of intersection between the two
 // offsets of the filleted curves, where the offset distance is equal to the
 // fillet radius.  Since the offset curves may intersect each other in more
@@ -73,7 +76,13 @@ public:
     void setPickPoints(const AcGePoint3d  pickPoint[2]);
 
     Acad::ErrorStatus initializeFromPickPoints(const AcGeCurve3d* curve[2], 
-                                               double             radius);
+                                               double             radius,
+                                               const AcGeTol&     tol = geomTolerance());
+
+    // Initializes the configuration directly instead of from the pick points, 
+    // when it is already known, e.g. for a fillet of AssocFilletLineBatch
+    //
+    void setConfiguration(const bool isIncoming[2], int intersCrossingType);
 
     // Compute the fillet arc between the two curves based on the input radius and
     // the configuration data, and update (trim/extend) the input curves
@@ -83,7 +92,32 @@ public:
                                double         radius, 
                                const bool     isTrimCurve[2],
                                bool           adjustTweakedCurves,
-                               AcGeCircArc3d& filletArc);
+                               AcGeCircArc3d& filletArc,
+                               const AcGeTol& tol = geomTolerance());
+
+    // Trim or extend the input curves to the points of tangency with the fillet arc
+    // found by the last evaluate() that updated the state, without evaluating the
+    // fillet again. The curves must be the same as the curves given to evaluate()
+    //
+    Acad::ErrorStatus trimToLastFilletArc(AcGeCurve3d*   curve[2], 
+                                          const bool     isTrimCurve[2],
+                                          const AcGeTol& tol = geomTolerance()) const;
+
+    // Hash of the filed state. Two configurations with the same hash select the 
+    // same intersection for the same curves and radius
+    //
+    Adesk::UInt64 stateHash() const;
+
+    // Hash of all the data that defines the curve including its parameter range. 
+    // Returns false if the curve type is not known and cannot be hashed
+    //
+    static bool getCurveHash(const AcGeCurve3d*, Adesk::UInt64& hash);
+
+    // The relaxed tolerance used by the fillet geometry calculations. It is passed 
+    // explicitly to all the AcGe calls, the global AcGeContext::gTol is neither used
+    // nor modified, so that fillets can be evaluated concurrently on multiple threads
+    //
+    static AcGeTol geomTolerance();
 
     void transformBy(const AcGeMatrix3d&);
    
@@ -91,16 +125,93 @@ public:
     Acad::ErrorStatus dwgInFields (AcDbDwgFiler*);      
     Acad::ErrorStatus dxfOutFields(AcDbDxfFiler*) const;     
     Acad::ErrorStatus dxfInFields (AcDbDxfFiler*); 
+
+    // Whether the filed data are the same as those of the other configuration, 
+    // compared exactly. The offset sub-curve hint is not filed and not compared
+    //
+    bool hasSameState(const AssocFilletConfig& other) const { return getChangedFields(other) == 0; }
+
+    // Partial filing used for the partial undo of the action body. Only the filed
+    // data that differ from the other configuration are written, and they are
+    // read back on top of the current data
+    //
+    Acad::ErrorStatus dwgOutChangedFields(AcDbDwgFiler*, const AssocFilletConfig& other) const;
+    Acad::ErrorStatus dwgInChangedFields (AcDbDwgFiler*);
+
+    // The unbounded offset curves of splines, ellipses and composite curves are 
+    // kept in a process-wide LRU cache, so that the input curve that does not 
+    // change during grip dragging is not offset again on every drag sample.
+    // Each evaluation gets its own copy of the cached curves. The memory budget
+    // is in bytes, 0 disables caching
+    //
+    static void   setOffsetCurveCacheBudget(size_t memoryBudget);
+    static size_t offsetCurveCacheBudget();
+    static void   getOffsetCurveCacheStatistics(Adesk::UInt64& hits, Adesk::UInt64& misses, size_t& memoryUsed);
+    static void   clearOffsetCurveCache();
+
+    // Number of threads used to intersect the pairs of offset sub-curves when the
+    // offsets of splines or composite curves consist of many sub-curves. The chosen
+    // intersection is the same for any thread count. The default is 1, i.e. the 
+    // pairs are intersected one after another on the calling thread. 
+    // setIntersectionThreadCount() starts numThreads - 1 persistent worker threads,
+    // fewer if the system cannot create them, and the count must be set back to 1 
+    // before the application is unloaded
+    //
+    static void setIntersectionThreadCount(int numThreads);
+    static int  intersectionThreadCount();
+
+    // Whether the fillet centers on ellipses and splines are tracked from the 
+    // previous parameters before enumerating all intersections of the offset
+    // curves. A tracked center is only taken if enumeration would choose the
+    // same one, so this only changes speed. The default is true
+    //
+    static void setIntersectionTrackingEnabled(bool yesNo);
+    static bool isIntersectionTrackingEnabled();
+
+    // Number of evaluations whose fillet center was tracked, without enumerating
+    // the intersections of the offset curves
+    //
+    static Adesk::UInt64 numTrackedIntersections();
+    static void          resetNumTrackedIntersections();
+
+    // Number of evaluations that returned eInvalidInput right away, because the 
+    // radius and the types and positions of the curves make the fillet impossible
+    //
+    static Adesk::UInt64 numInfeasibleFillets();
+    static void          resetNumInfeasibleFillets();
+
+    // Number of crossings of the curves classified by the fast floating-point
+    // orientation test, and by the exact test the fast one falls back to when
+    // the tangents are too close to parallel for the rounding errors
+    //
+    static void getOrientationStatistics(Adesk::UInt64& numFiltered, Adesk::UInt64& numExact);
+    static void resetOrientationStatistics();
+
+    // Evaluates numFillets fillets between lines, arcs, ellipses, splines and 
+    // composite curves generated from fixed seeds, first one after another and 
+    // then on numThreads threads at the same time. Returns the number of fillets
+    // whose concurrent results are not bit for bit the same as the serial ones.
+    // It is meant for testing, it clears the offset curve cache
+    //
+    static int runConcurrentEvaluationTest(int            numFillets, 
+                                           int            numThreads, 
+                                           const AcGeTol& tol = geomTolerance());
     
 private:
     // Return the point of intersection on the two (non-offset) curves about which 
     // the fillet arc was created. The fillet arc is created by intersecting two 
     // offset curves, and it may be the case that the original (non-offset) curves 
     // do not actually intersect. In this case, this function will return non eOk.  
-    // Otherwise it will return eOk along with the intersection point
+    // Otherwise it will return eOk along with the intersection point.
+    //
+    // The iterator that has been used to find the fillet arc center is restarted
+    // on the unbounded base curves, so that they do not need to be created again.
+    // The param[] are the parameters of the fillet arc end points on the curves
     //
-    Acad::ErrorStatus getIntersectionPoint(const AcGeCurve3d* curve[2], 
-                                           AcGePoint3d&       intersPoint) const;
+    Acad::ErrorStatus getIntersectionPoint(AcDbOffsetCurveIntersectionIter& iter,
+                                           const AcGeCurve3d*               curve[2], 
+                                           const double                     param[2],
+                                           AcGePoint3d&                     intersPoint) const;
 
     // Adjust the tweaked line in case its one end point is at the endpoint of the 
     // current fillet arc but the other endpoint changed. Adjust it as if its first 
@@ -108,17 +219,33 @@ private:
     // the dragging behave as if the line was extended to intersect the other curve 
     // and then stretched or rotated, making it a more intuitive dragging behavior
     //
-    void adjustTweakedLine(int index, AcGeCurve3d*) const;
+    void adjustTweakedLine(int index, AcGeCurve3d*, const AcGeTol&) const;
 
     // Trim or extend the input curve to the input parameter
     //
-    static Acad::ErrorStatus trimOrExtendCurve(AcGeCurve3d*, double param, bool isIncoming);
+    static Acad::ErrorStatus trimOrExtendCurve(AcGeCurve3d*, const PreparedCurve&, double param, bool isIncoming, const AcGeTol&);
 
     // Set the value of mIntersCrossingType based on the given intersection configuration 
     // and mIsIncoming[]
     //
     Acad::ErrorStatus setIntersectionCrossingType(AcGe::AcGeXConfig config[2]);
 
+    // Groups of the filed data, written and read together by the partial filing
+    //
+    enum Field
+    {
+        kIsIncomingField         = 0x01,
+        kIntersCrossingTypeField = 0x02,
+        kParamField              = 0x04,
+        kArcEndPointField        = 0x08,
+        kIntersPointField        = 0x10, // mHaveIntersPoint and mIntersPoint
+        kPickPointField          = 0x20, // mIsInitialized and mPickPoint[]
+    };
+
+    // Combination of the Field bits of the filed data that differ from the other configuration
+    //
+    unsigned getChangedFields(const AssocFilletConfig& other) const;
+
     bool         mIsIncoming[2];
     int          mIntersCrossingType; // 1 == First curve crosess the second curve from left to right, 0 == First curve crosses from right to left
     double       mParam[2];           // Parameters at points of tangency of each curve with fillet arc
@@ -127,24 +254,8 @@ private:
     bool         mHaveIntersPoint;    // mIntersPoint is valid iff mHaveIntersPoint is true
     bool         mIsInitialized;      // The configuration has been intialized from the pick points
     AcGePoint3d  mPickPoint[2];       // Used when !mIsInitialized to intialize other data
-};
-
-
-class AcGeTolSetter
-{
-public:
-    explicit AcGeTolSetter(double distanceTol = 1e-6, double unitValueTol = 1e-10)
-    {
-        mPrevTol = AcGeContext::gTol;
-        AcGeContext::gTol.setEqualPoint (distanceTol);
-        AcGeContext::gTol.setEqualVector(unitValueTol);
-    }
-    ~AcGeTolSetter()
-    {
-        AcGeContext::gTol = mPrevTol;
-    }
-private:
-    AcGeTol mPrevTol;
+    int          mCurvePairHint[2];   // Offset sub-curves that gave the last intersection, -1 if unknown. Not filed
+    int          mWindowSegmentHint[2]; // Segments of composite curves touched by the last fillet arc, -1 if unknown. Not filed
 };
 
 #pragma pack (pop)
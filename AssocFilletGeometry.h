@@ -0,0 +1,346 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  Copyright 2014 Autodesk, Inc.  All rights reserved.
+//
+//  Use of this software is subject to the terms of the Autodesk license 
+//  agreement provided at the time of installation or download, or which 
+//  otherwise accompanies this software in either electronic or hard copy form.   
+//
+// DESCRIPTION:
+//
+// Look at this file only if you are interested in the fillet math that does not
+// depend on ObjectARX. This file contains the header-only geometry core used by
+// AssocFilletConfig: closed-form intersection of offset lines and circles,
+// selection of the intersection that matches the fillet configuration,
+// trimming of the curve parameter range and construction of the fillet arc.
+//
+// The core is templated on a traits class that provides the point, vector and
+// crossing configuration types and the few operations on them. AssocFilletAcGeTraits.h
+// adapts it to AcGe and AssocFilletStdTraits.h to plain C++ types, so that these
+// steps can be built and profiled without ObjectARX.
+//
+// This is not the whole fillet solver. The offsetting of the curves, the general
+// curve/curve and the ellipse offset intersections, the spline and composite 
+// curve windows and the intersection tracking still use AcGe and stay in 
+// AssocFilletConfig.cpp, so without ObjectARX only the steps above can be run,
+// which covers what fillets of lines and circular arcs need.
+//
+// The traits class must provide:
+//
+//    typedef ... Point;
+//    typedef ... Vector;
+//    typedef ... Config;  // Configuration of two curves at their intersection
+//
+//    static Vector difference(const Point& p, const Point& q);   // p - q
+//    static Point  translate (const Point& p, const Vector& v);  // p + v
+//    static Vector add       (const Vector& u, const Vector& v); // u + v
+//    static Vector scale     (double s, const Vector& v);        // s * v
+//    static double dot       (const Vector& u, const Vector& v);
+//    static Vector cross     (const Vector& u, const Vector& v);
+//    static int    crossingType(const Config& config); // 1 == left to right, 0 == right to left,
+//                                                      // -1 == tangential, -2 == not defined
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include <math.h>
+#pragma pack (push, 8)
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+namespace AssocFilletGeometry
+{
+
+// Not std::min/max, which collide with the min/max macros of windows.h
+//
+inline double minValue(double a, double b) { return a < b ? a : b; }
+inline double maxValue(double a, double b) { return a > b ? a : b; }
+
+
+template <class Traits>
+double length(const typename Traits::Vector& v)
+{
+    return sqrt(Traits::dot(v, v));
+}
+
+
+// Angle between the two vectors, from 0 to PI
+//
+template <class Traits>
+double angleBetween(const typename Traits::Vector& u, const typename Traits::Vector& v)
+{
+    return atan2(length<Traits>(Traits::cross(u, v)), Traits::dot(u, v));
+}
+
+
+// Takes into account that the curve may be periodic or closed, and returns the
+// shortest distance that may happen to be over the seam or end of the curve.
+// The lower and upper bounds are only used for closed non-periodic curves
+//
+inline double paramDistance(bool isClosed, double lowerBound, double upperBound, double paramPeriod, double param0, double param1)
+{
+    double minDist = fabs(param1 - param0);
+
+    if (paramPeriod != 0.0)
+    {
+        param0 = fmod(param0 + 2*paramPeriod, paramPeriod);
+        param1 = fmod(param1 + 2*paramPeriod, paramPeriod);
+
+        minDist = minValue(minDist, fabs(param0 - param1 + paramPeriod));
+        minDist = minValue(minDist, fabs(param1 - param0 + paramPeriod));
+    }
+    else if (isClosed)
+    {
+        // Closed curve (the start and end point coincide)
+        //
+        minDist = minValue(minDist, fabs(param0 - lowerBound) + fabs(param1 - upperBound));
+        minDist = minValue(minDist, fabs(param1 - lowerBound) + fabs(param0 - upperBound));
+    }
+    return minDist;
+}
+
+
+// Intersection of the offset lines origin0 + t0*vec0 and origin1 + t1*vec1,
+// the origins are already offset. Parallel lines have no isolated intersection
+//
+template <class Traits>
+bool intersectOffsetLines(const typename Traits::Point&  origin0,
+                          const typename Traits::Vector& vec0,
+                          const typename Traits::Point&  origin1,
+                          const typename Traits::Vector& vec1,
+                          const typename Traits::Vector& normal,
+                          double                         eqVector,
+                          typename Traits::Point         points[2],
+                          int&                           numPoints)
+{
+    const double denom = Traits::dot(normal, Traits::cross(vec0, vec1));
+    if (fabs(denom) <= eqVector * length<Traits>(vec0) * length<Traits>(vec1))
+        return true; // Parallel offset lines, no isolated intersection
+    const typename Traits::Vector p0p1 = Traits::difference(origin1, origin0);
+    points[numPoints++] = Traits::translate(origin0, Traits::scale(Traits::dot(normal, Traits::cross(p0p1, vec1)) / denom, vec0));
+    return true;
+}
+
+
+// Intersection of the offset line |origin + t*vec - center| == radius with the
+// offset circle. Returns false if the intersection is (nearly) tangential
+//
+template <class Traits>
+bool intersectOffsetLineCircle(const typename Traits::Point&  origin,
+                               const typename Traits::Vector& vec,
+                               const typename Traits::Point&  center,
+                               double                         radius,
+                               double                         eqPoint,
+                               typename Traits::Point         points[2],
+                               int&                           numPoints)
+{
+    const typename Traits::Vector w = Traits::difference(origin, center);
+    const double a = Traits::dot(vec, vec);
+    const double b = Traits::dot(w, vec) / a; // Parameter of the closest point to the center, negated
+    const double centerDist = length<Traits>(Traits::add(w, Traits::scale(-b, vec)));
+    if (fabs(centerDist - radius) <= eqPoint)
+        return false; // Tangential
+    if (centerDist > radius)
+        return true;  // No intersection
+    const double dt = sqrt((radius * radius - centerDist * centerDist) / a);
+    points[numPoints++] = Traits::translate(origin, Traits::scale(-b - dt, vec));
+    points[numPoints++] = Traits::translate(origin, Traits::scale(-b + dt, vec));
+    return true;
+}
+
+
+// Intersection of two offset circles lying in the plane of the normal. Returns
+// false if the intersection is (nearly) tangential
+//
+template <class Traits>
+bool intersectOffsetCircles(const typename Traits::Point&  center0,
+                            double                         r0,
+                            const typename Traits::Point&  center1,
+                            double                         r1,
+                            const typename Traits::Vector& normal,
+                            double                         eqPoint,
+                            typename Traits::Point         points[2],
+                            int&                           numPoints)
+{
+    const typename Traits::Vector c0c1 = Traits::difference(center1, center0);
+    const double dist = length<Traits>(c0c1);
+    if (dist <= eqPoint)
+        return true; // Concentric circles, no isolated intersection
+    if (fabs(dist - (r0 + r1)) <= eqPoint || fabs(dist - fabs(r0 - r1)) <= eqPoint)
+        return false; // Tangential
+    if (dist > r0 + r1 || dist < fabs(r0 - r1))
+        return true;  // No intersection
+    const typename Traits::Vector xVec = Traits::scale(1.0 / dist, c0c1);
+    const typename Traits::Vector yVec = Traits::cross(normal, xVec);
+    const double x = (r0 * r0 - r1 * r1 + dist * dist) / (2.0 * dist);
+    const double y = sqrt(maxValue(0.0, r0 * r0 - x * x));
+    const typename Traits::Point onAxis = Traits::translate(center0, Traits::scale(x, xVec));
+    points[numPoints++] = Traits::translate(onAxis, Traits::scale(-y, yVec));
+    points[numPoints++] = Traits::translate(onAxis, Traits::scale( y, yVec));
+    return true;
+}
+
+
+// Parameter on the line origin + t*vec of the given point of its offset, the
+// offset origin being the origin of the offset line
+//
+template <class Traits>
+double getLineParam(const typename Traits::Point&  offsetOrigin,
+                    const typename Traits::Vector& vec,
+                    const typename Traits::Point&  offsetPoint)
+{
+    return Traits::dot(Traits::difference(offsetPoint, offsetOrigin), vec) / Traits::dot(vec, vec);
+}
+
+
+// Angular parameter from 0 to 2*PI on the circle with the given center and
+// coordinate system of the given point of its offset, and the tangent there
+//
+template <class Traits>
+double getCircleParam(const typename Traits::Point&  center,
+                      const typename Traits::Vector& refVec,
+                      const typename Traits::Vector& yVec,
+                      const typename Traits::Point&  offsetPoint,
+                      typename Traits::Vector&       tangent)
+{
+    const typename Traits::Vector radial = Traits::difference(offsetPoint, center);
+    double angle = atan2(Traits::dot(radial, yVec), Traits::dot(radial, refVec));
+    if (angle < 0.0)
+        angle += 2*M_PI; // The unbounded circle is parameterized from 0 to 2*PI
+    tangent = Traits::add(Traits::scale(-sin(angle), refVec), Traits::scale(cos(angle), yVec));
+    return angle;
+}
+
+
+// Whether the intersection with the given configuration of the offset curves
+// may be the center of the fillet with the given mIntersCrossingType. The
+// tangential intersections match either crossing type
+//
+template <class Traits>
+bool isMatchingCrossing(int intersCrossingType, const typename Traits::Config& config)
+{
+    const int crossingType = Traits::crossingType(config);
+    return crossingType == intersCrossingType || crossingType == -1;
+}
+
+
+// Chooses among the intersections of the offset curves the one that matches
+// the fillet configuration and is the closest to the previous parameters.
+// A candidate within matchParamDist is taken without looking at the rest
+//
+template <class Traits>
+class CandidateSelector
+{
+public:
+    CandidateSelector(int intersCrossingType, double matchParamDist)
+      : mIntersCrossingType(intersCrossingType), mMatchParamDist(matchParamDist), mMinParamDist(1e30)
+    {
+        mBestParam[0] = mBestParam[1] = 0.0;
+    }
+
+    bool isMatching(const typename Traits::Config& config) const
+    {
+        return isMatchingCrossing<Traits>(mIntersCrossingType, config);
+    }
+
+    // Returns true if the candidate is the best so far
+    //
+    bool offer(const typename Traits::Point& point, const double param[2], double paramDist)
+    {
+        if (paramDist >= mMinParamDist)
+            return false;
+        mMinParamDist = paramDist;
+        mBestPoint    = point;
+        mBestParam[0] = param[0];
+        mBestParam[1] = param[1];
+        return true;
+    }
+
+    bool isDone () const { return mMinParamDist <= mMatchParamDist; }
+    bool hasBest() const { return mMinParamDist <= 1e29; }
+
+    const typename Traits::Point& bestPoint() const { return mBestPoint; }
+    double bestParam(int index) const               { return mBestParam[index]; }
+
+private:
+    int                     mIntersCrossingType;
+    double                  mMatchParamDist;
+    double                  mMinParamDist;
+    typename Traits::Point  mBestPoint;
+    double                  mBestParam[2];
+};
+
+
+// Trims or extends the parameter range of a non-periodic curve to the given
+// parameter, keeping the part before it if the curve is incoming into the
+// fillet arc and the part after it otherwise. Returns false if the range
+// would be empty or reversed
+//
+inline bool trimParamRange(bool    isBoundedBelow,
+                           bool    isBoundedAbove,
+                           double& lowerBound,
+                           double& upperBound,
+                           double  param,
+                           bool    isIncoming)
+{
+    if (isIncoming)
+    {
+        upperBound     = param;
+        isBoundedAbove = true;
+    }
+    else
+    {
+        lowerBound     = param;
+        isBoundedBelow = true;
+    }
+    return !(isBoundedBelow && isBoundedAbove && lowerBound >= upperBound);
+}
+
+
+// The fillet arc of the given radius is centered at the intersection of the
+// offset curves and touches the curves at endPoint0 and endPoint1. Returns
+// the reference vector from the center to the start of the arc and the arc
+// angle counterclockwise around the normal.
+//
+// If the end points are diametrically opposite (tangent intersection), the
+// arc goes around the side given by the derivative of the second curve at
+// its end point and by whether the first curve is incoming
+//
+template <class Traits>
+void getFilletArc(const typename Traits::Point&  center,
+                  const typename Traits::Point&  endPoint0,
+                  const typename Traits::Point&  endPoint1,
+                  const typename Traits::Vector& normal,
+                  const typename Traits::Vector& deriv1,
+                  bool                           isIncoming0,
+                  double                         eqVector,
+                  typename Traits::Vector&       refVec,
+                  double&                        angle)
+{
+    const typename Traits::Vector vec0 = Traits::difference(endPoint0, center);
+    const typename Traits::Vector vec1 = Traits::difference(endPoint1, center);
+    typename Traits::Vector vec2 = Traits::cross(vec0, vec1);
+
+    if (length<Traits>(vec2) <= eqVector)
+    {
+        // 180 degree arc (tangent intersection)
+        //
+        vec2 = isIncoming0 ? deriv1 : Traits::scale(-1.0, deriv1);
+        vec2 = Traits::cross(normal, vec2);
+        refVec = Traits::dot(vec2, vec1) > 0.0 ? vec1 : vec0;
+        angle  = M_PI;
+    }
+    else
+    {
+        // Regular case where arc angle is less than 180 degrees
+        //
+        refVec = Traits::dot(vec2, normal) > 0.0 ? vec0 : vec1;
+        angle  = angleBetween<Traits>(vec0, vec1);
+    }
+}
+
+} // namespace AssocFilletGeometry
+
+#pragma pack (pop)
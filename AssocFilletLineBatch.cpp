@@ -0,0 +1,548 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  Copyright 2014 Autodesk, Inc.  All rights reserved.
+//
+//  Use of this software is subject to the terms of the Autodesk license 
+//  agreement provided at the time of installation or download, or which 
+//  otherwise accompanies this software in either electronic or hard copy form.   
+//
+// DESCRIPTION:
+//
+// This file contains implementation of AssocFilletLineBatch class that computes
+// fillets between pairs of line segments in bulk.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include "StdAfx.h"
+#include <math.h>
+#include <vector>
+#include <random>
+#include <intrin.h>
+#include <immintrin.h>
+#include "gelnsg3d.h"
+#include "gearc3d.h"
+#include "AssocFilletLineBatch.h"
+
+
+// The fillet of two lines lying in the XY plane is computed the same way as the
+// closed-form offset intersection in AssocFilletConfig.cpp does it, but in 2D:
+//
+//  - The normal is the Z axis multiplied by the sign of the cross product of
+//    the line directions d0 x d1
+//  - The left side of the line i is the side of normal x d[i], and each line is
+//    offset to its left side by the radius if the fillet configuration says so,
+//    otherwise to its right side
+//  - The center of the fillet arc is the intersection of the offset lines,
+//    p0 + t0*d0 == p1 + t1*d1, where t0 and t1 are also the parameters of the
+//    points of tangency on the lines, because the offsets are perpendicular
+//
+// The computation of the center, points of tangency and trimmed lines has no
+// branches, so that four fillets are computed the same way as one fillet.
+// Only the arc angles are computed by atan2() afterwards, one fillet at a time
+//
+
+
+// Fillet of the lines at the given index, computed without AVX
+//
+static void evaluateLineFillet(const AssocFilletLineBatchInput& input,
+                               AssocFilletLineBatchOutput&      output,
+                               int                              k,
+                               const AcGeTol&                   tol)
+{
+    const double d0x = input.mEndX[0][k] - input.mStartX[0][k];
+    const double d0y = input.mEndY[0][k] - input.mStartY[0][k];
+    const double d1x = input.mEndX[1][k] - input.mStartX[1][k];
+    const double d1y = input.mEndY[1][k] - input.mStartY[1][k];
+    const double len0  = sqrt(d0x * d0x + d0y * d0y);
+    const double len1  = sqrt(d1x * d1x + d1y * d1y);
+    const double cross = d0x * d1y - d0y * d1x;
+    const double sign  = cross > 0.0 ? 1.0 : -1.0;
+
+    // Same as bool left[2] = { !mIsIncoming[1], mIsIncoming[0], } in evaluate()
+    //
+    const double side0 = input.mIsIncoming[1][k] ? -1.0 :  1.0;
+    const double side1 = input.mIsIncoming[0][k] ?  1.0 : -1.0;
+    const double off0  = sign * side0 * input.mRadius[k] / len0;
+    const double off1  = sign * side1 * input.mRadius[k] / len1;
+
+    const double p0x = input.mStartX[0][k] - off0 * d0y;
+    const double p0y = input.mStartY[0][k] + off0 * d0x;
+    const double p1x = input.mStartX[1][k] - off1 * d1y;
+    const double p1y = input.mStartY[1][k] + off1 * d1x;
+    const double wx  = p1x - p0x;
+    const double wy  = p1y - p0y;
+    const double t0  = (wx * d1y - wy * d1x) / cross;
+    const double t1  = (wx * d0y - wy * d0x) / cross;
+
+    output.mCenterX[k]     = p0x + t0 * d0x;
+    output.mCenterY[k]     = p0y + t0 * d0y;
+    output.mParam[0][k]    = t0;
+    output.mParam[1][k]    = t1;
+    output.mTangentX[0][k] = input.mStartX[0][k] + t0 * d0x;
+    output.mTangentY[0][k] = input.mStartY[0][k] + t0 * d0y;
+    output.mTangentX[1][k] = input.mStartX[1][k] + t1 * d1x;
+    output.mTangentY[1][k] = input.mStartY[1][k] + t1 * d1y;
+
+    const double eqPoint = tol.equalPoint();
+    bool isValid = len0 > eqPoint && len1 > eqPoint &&
+                   fabs(cross) > tol.equalVector() * len0 * len1 && // Parallel lines
+                   input.mIntersCrossingType[k] == 1 &&
+                   input.mRadius[k] >= 0.0;
+
+    // Same as AssocFilletConfig::trimOrExtendCurve(): the end of an incoming line
+    // and the start of an outgoing line is moved to the point of tangency, and the
+    // trimmed line must not be reversed or degenerate
+    //
+    const double param[2]  = { t0, t1, };
+    const double length[2] = { len0, len1, };
+    for (int i = 0; i < 2; i++)
+    {
+        const bool isTrim     = input.mIsTrimCurve[i][k];
+        const bool isIncoming = input.mIsIncoming[i][k];
+        output.mTrimmedStartX[i][k] = isTrim && !isIncoming ? output.mTangentX[i][k] : input.mStartX[i][k];
+        output.mTrimmedStartY[i][k] = isTrim && !isIncoming ? output.mTangentY[i][k] : input.mStartY[i][k];
+        output.mTrimmedEndX  [i][k] = isTrim &&  isIncoming ? output.mTangentX[i][k] : input.mEndX  [i][k];
+        output.mTrimmedEndY  [i][k] = isTrim &&  isIncoming ? output.mTangentY[i][k] : input.mEndY  [i][k];
+        if (isTrim)
+        {
+            const double trimmedLength = (isIncoming ? param[i] : 1.0 - param[i]) * length[i];
+            isValid = isValid && trimmedLength > eqPoint;
+        }
+    }
+    output.mIsValid[k] = isValid;
+}
+
+
+// All bits set in the lanes whose flag is true
+//
+static __m256d getLaneMask(bool flag0, bool flag1, bool flag2, bool flag3)
+{
+    const __m256d flags = _mm256_set_pd(flag3 ? 1.0 : 0.0, flag2 ? 1.0 : 0.0, flag1 ? 1.0 : 0.0, flag0 ? 1.0 : 0.0);
+    return _mm256_cmp_pd(flags, _mm256_setzero_pd(), _CMP_NEQ_OQ);
+}
+
+
+// Fillets of the lines at the four indices starting at the given index
+//
+static void evaluateLineFillets4(const AssocFilletLineBatchInput& input,
+                                 AssocFilletLineBatchOutput&      output,
+                                 int                              k,
+                                 const AcGeTol&                   tol)
+{
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d one  = _mm256_set1_pd(1.0);
+    const __m256d eqPoint = _mm256_set1_pd(tol.equalPoint());
+
+    __m256d startX[2], startY[2], endX[2], endY[2], d[2][2], len[2];
+    for (int i = 0; i < 2; i++)
+    {
+        startX[i] = _mm256_loadu_pd(input.mStartX[i] + k);
+        startY[i] = _mm256_loadu_pd(input.mStartY[i] + k);
+        endX[i]   = _mm256_loadu_pd(input.mEndX  [i] + k);
+        endY[i]   = _mm256_loadu_pd(input.mEndY  [i] + k);
+        d[i][0]   = _mm256_sub_pd(endX[i], startX[i]);
+        d[i][1]   = _mm256_sub_pd(endY[i], startY[i]);
+        len[i]    = _mm256_sqrt_pd(_mm256_add_pd(_mm256_mul_pd(d[i][0], d[i][0]), _mm256_mul_pd(d[i][1], d[i][1])));
+    }
+    const __m256d cross = _mm256_sub_pd(_mm256_mul_pd(d[0][0], d[1][1]), _mm256_mul_pd(d[0][1], d[1][0]));
+    const __m256d sign  = _mm256_blendv_pd(_mm256_set1_pd(-1.0), one, _mm256_cmp_pd(cross, zero, _CMP_GT_OQ));
+
+    // The bool flags are not suitable for vector loads, they are gathered into
+    // lane masks one fillet at a time
+    //
+    const bool* const* isIncoming = input.mIsIncoming;
+    const bool* const* isTrim     = input.mIsTrimCurve;
+    __m256d incomingMask[2], trimStartMask[2], trimEndMask[2];
+    for (int i = 0; i < 2; i++)
+    {
+        incomingMask [i] = getLaneMask(isIncoming[i][k], isIncoming[i][k + 1], isIncoming[i][k + 2], isIncoming[i][k + 3]);
+        trimStartMask[i] = _mm256_andnot_pd(incomingMask[i], getLaneMask(isTrim[i][k], isTrim[i][k + 1], isTrim[i][k + 2], isTrim[i][k + 3]));
+        trimEndMask  [i] = _mm256_and_pd   (incomingMask[i], getLaneMask(isTrim[i][k], isTrim[i][k + 1], isTrim[i][k + 2], isTrim[i][k + 3]));
+    }
+    const __m256d side0  = _mm256_blendv_pd(one, _mm256_set1_pd(-1.0), incomingMask[1]);
+    const __m256d side1  = _mm256_blendv_pd(_mm256_set1_pd(-1.0), one, incomingMask[0]);
+    const __m256d radius = _mm256_loadu_pd(input.mRadius + k);
+    const __m256d off0   = _mm256_div_pd(_mm256_mul_pd(_mm256_mul_pd(sign, side0), radius), len[0]);
+    const __m256d off1   = _mm256_div_pd(_mm256_mul_pd(_mm256_mul_pd(sign, side1), radius), len[1]);
+
+    const __m256d p0x = _mm256_sub_pd(startX[0], _mm256_mul_pd(off0, d[0][1]));
+    const __m256d p0y = _mm256_add_pd(startY[0], _mm256_mul_pd(off0, d[0][0]));
+    const __m256d p1x = _mm256_sub_pd(startX[1], _mm256_mul_pd(off1, d[1][1]));
+    const __m256d p1y = _mm256_add_pd(startY[1], _mm256_mul_pd(off1, d[1][0]));
+    const __m256d wx  = _mm256_sub_pd(p1x, p0x);
+    const __m256d wy  = _mm256_sub_pd(p1y, p0y);
+    __m256d param[2];
+    param[0] = _mm256_div_pd(_mm256_sub_pd(_mm256_mul_pd(wx, d[1][1]), _mm256_mul_pd(wy, d[1][0])), cross);
+    param[1] = _mm256_div_pd(_mm256_sub_pd(_mm256_mul_pd(wx, d[0][1]), _mm256_mul_pd(wy, d[0][0])), cross);
+
+    _mm256_storeu_pd(output.mCenterX + k, _mm256_add_pd(p0x, _mm256_mul_pd(param[0], d[0][0])));
+    _mm256_storeu_pd(output.mCenterY + k, _mm256_add_pd(p0y, _mm256_mul_pd(param[0], d[0][1])));
+
+    // Same conditions as in evaluateLineFillet()
+    //
+    const __m256d crossTol = _mm256_mul_pd(_mm256_set1_pd(tol.equalVector()), _mm256_mul_pd(len[0], len[1]));
+    __m256d isValid = _mm256_and_pd(_mm256_cmp_pd(len[0], eqPoint, _CMP_GT_OQ), _mm256_cmp_pd(len[1], eqPoint, _CMP_GT_OQ));
+    isValid = _mm256_and_pd(isValid, _mm256_cmp_pd(_mm256_max_pd(cross, _mm256_sub_pd(zero, cross)), crossTol, _CMP_GT_OQ));
+    isValid = _mm256_and_pd(isValid, _mm256_cmp_pd(radius, zero, _CMP_GE_OQ));
+
+    for (int i = 0; i < 2; i++)
+    {
+        const __m256d tangentX = _mm256_add_pd(startX[i], _mm256_mul_pd(param[i], d[i][0]));
+        const __m256d tangentY = _mm256_add_pd(startY[i], _mm256_mul_pd(param[i], d[i][1]));
+        _mm256_storeu_pd(output.mParam[i]    + k, param[i]);
+        _mm256_storeu_pd(output.mTangentX[i] + k, tangentX);
+        _mm256_storeu_pd(output.mTangentY[i] + k, tangentY);
+
+        const __m256d trimStart = trimStartMask[i];
+        const __m256d trimEnd   = trimEndMask[i];
+        _mm256_storeu_pd(output.mTrimmedStartX[i] + k, _mm256_blendv_pd(startX[i], tangentX, trimStart));
+        _mm256_storeu_pd(output.mTrimmedStartY[i] + k, _mm256_blendv_pd(startY[i], tangentY, trimStart));
+        _mm256_storeu_pd(output.mTrimmedEndX  [i] + k, _mm256_blendv_pd(endX[i],   tangentX, trimEnd));
+        _mm256_storeu_pd(output.mTrimmedEndY  [i] + k, _mm256_blendv_pd(endY[i],   tangentY, trimEnd));
+
+        const __m256d startLength = _mm256_mul_pd(_mm256_sub_pd(one, param[i]), len[i]);
+        const __m256d endLength   = _mm256_mul_pd(param[i], len[i]);
+        isValid = _mm256_andnot_pd(_mm256_and_pd(trimStart, _mm256_cmp_pd(startLength, eqPoint, _CMP_LE_OQ)), isValid);
+        isValid = _mm256_andnot_pd(_mm256_and_pd(trimEnd,   _mm256_cmp_pd(endLength,   eqPoint, _CMP_LE_OQ)), isValid);
+    }
+
+    const int validMask = _mm256_movemask_pd(isValid);
+    for (int j = 0; j < 4; j++)
+    {
+        output.mIsValid[k + j] = (validMask & (1 << j)) != 0 && input.mIntersCrossingType[k + j] == 1;
+    }
+}
+
+
+// Start and end angle of the fillet arc from the center and the points of
+// tangency. The arc starts at the point of tangency from which the other
+// one is less than 180 degrees counterclockwise
+//
+static void getLineFilletArcAngles(AssocFilletLineBatchOutput& output, int k)
+{
+    const double v0x = output.mTangentX[0][k] - output.mCenterX[k];
+    const double v0y = output.mTangentY[0][k] - output.mCenterY[k];
+    const double v1x = output.mTangentX[1][k] - output.mCenterX[k];
+    const double v1y = output.mTangentY[1][k] - output.mCenterY[k];
+    const bool isStartAt0 = v0x * v1y - v0y * v1x > 0.0;
+
+    double startAngle = isStartAt0 ? atan2(v0y, v0x) : atan2(v1y, v1x);
+    double endAngle   = isStartAt0 ? atan2(v1y, v1x) : atan2(v0y, v0x);
+    if (startAngle < 0.0)
+        startAngle += 2*M_PI;
+    while (endAngle < startAngle)
+        endAngle += 2*M_PI;
+    output.mStartAngle[k] = startAngle;
+    output.mEndAngle  [k] = endAngle;
+}
+
+
+// AVX2 requires support by the processor (CPUID leaf 7) and the operating
+// system saving the YMM registers on context switches (XGETBV)
+//
+static bool detectSimdSupport()
+{
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return false;
+
+    __cpuid(info, 1);
+    const bool hasOsxsave = (info[2] & (1 << 27)) != 0;
+    const bool hasAvx     = (info[2] & (1 << 28)) != 0;
+    if (!hasOsxsave || !hasAvx)
+        return false;
+    if ((_xgetbv(0) & 0x6) != 0x6)
+        return false; // The OS does not save the XMM and YMM registers
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+}
+
+
+// Initialized when the module is loaded, not on the first use, because
+// function-local statics are not initialized in a thread-safe way
+//
+static const bool sIsSimdSupported = detectSimdSupport();
+
+
+bool AssocFilletLineBatch::isSimdSupported()
+{
+    return sIsSimdSupported;
+}
+
+
+int AssocFilletLineBatch::evaluate(const AssocFilletLineBatchInput& input,
+                                   AssocFilletLineBatchOutput&      output,
+                                   bool                             allowSimd,
+                                   const AcGeTol&                   tol)
+{
+    const int numFillets = input.mNumFillets;
+    int k = 0;
+
+    if (allowSimd && sIsSimdSupported)
+    {
+        for (; k + 4 <= numFillets; k += 4)
+        {
+            evaluateLineFillets4(input, output, k, tol);
+        }
+        _mm256_zeroupper(); // Avoid the penalty of the transition to the SSE code that follows
+    }
+    for (; k < numFillets; k++)
+    {
+        evaluateLineFillet(input, output, k, tol);
+    }
+
+    int numValid = 0;
+    for (k = 0; k < numFillets; k++)
+    {
+        getLineFilletArcAngles(output, k);
+        if (output.mIsValid[k])
+            numValid++;
+    }
+    return numValid;
+}
+
+
+// Owns the arrays of an AssocFilletLineBatchOutput, used by verify()
+//
+class LineBatchOutputBuffer
+{
+public:
+    explicit LineBatchOutputBuffer(int numFillets);
+    ~LineBatchOutputBuffer() { delete [] mIsValid; }
+
+    AssocFilletLineBatchOutput& output() { return mOutput; }
+
+private:
+    LineBatchOutputBuffer(const LineBatchOutputBuffer&);            // Not copyable
+    LineBatchOutputBuffer& operator=(const LineBatchOutputBuffer&);
+
+    enum { kNumDoubleArrays = 18 };
+
+    std::vector<double>        mValues;
+    bool*                      mIsValid;
+    AssocFilletLineBatchOutput mOutput;
+};
+
+
+LineBatchOutputBuffer::LineBatchOutputBuffer(int numFillets)
+  : mValues(kNumDoubleArrays * (numFillets + 1)), mIsValid(new bool[numFillets + 1])
+{
+    double* pNext = &mValues[0];
+    double** const arrays[kNumDoubleArrays] = 
+    {
+        &mOutput.mCenterX,          &mOutput.mCenterY,          &mOutput.mStartAngle,       &mOutput.mEndAngle,
+        &mOutput.mTangentX[0],      &mOutput.mTangentY[0],      &mOutput.mTangentX[1],      &mOutput.mTangentY[1],
+        &mOutput.mParam[0],         &mOutput.mParam[1],
+        &mOutput.mTrimmedStartX[0], &mOutput.mTrimmedStartY[0], &mOutput.mTrimmedEndX[0],   &mOutput.mTrimmedEndY[0],
+        &mOutput.mTrimmedStartX[1], &mOutput.mTrimmedStartY[1], &mOutput.mTrimmedEndX[1],   &mOutput.mTrimmedEndY[1],
+    };
+    for (int i = 0; i < kNumDoubleArrays; i++)
+    {
+        *arrays[i] = pNext;
+        pNext     += numFillets + 1;
+    }
+    mOutput.mIsValid = mIsValid;
+}
+
+
+static bool isSamePoint(double x0, double y0, double x1, double y1, const AcGeTol& tol)
+{
+    return AcGePoint3d(x0, y0, 0.0).isEqualTo(AcGePoint3d(x1, y1, 0.0), tol);
+}
+
+
+// Whether the fillet at the given index is the same in the two outputs
+//
+static bool isSameLineFillet(const AssocFilletLineBatchOutput& output0, 
+                             const AssocFilletLineBatchOutput& output1, 
+                             int                               k, 
+                             const AcGeTol&                    tol)
+{
+    if (output0.mIsValid[k] != output1.mIsValid[k])
+        return false;
+    if (!output0.mIsValid[k])
+        return true;
+
+    bool isSame = isSamePoint(output0.mCenterX[k], output0.mCenterY[k], output1.mCenterX[k], output1.mCenterY[k], tol);
+    for (int i = 0; i < 2; i++)
+    {
+        isSame = isSame &&
+                 isSamePoint(output0.mTangentX[i][k],      output0.mTangentY[i][k],      output1.mTangentX[i][k],      output1.mTangentY[i][k],      tol) &&
+                 isSamePoint(output0.mTrimmedStartX[i][k], output0.mTrimmedStartY[i][k], output1.mTrimmedStartX[i][k], output1.mTrimmedStartY[i][k], tol) &&
+                 isSamePoint(output0.mTrimmedEndX[i][k],   output0.mTrimmedEndY[i][k],   output1.mTrimmedEndX[i][k],   output1.mTrimmedEndY[i][k],   tol);
+    }
+    return isSame;
+}
+
+
+// Whether AssocFilletConfig::evaluate() gives the same fillet for the lines at
+// the given index as the batch did
+//
+static bool isSameAsConfigEvaluate(const AssocFilletLineBatchInput&  input, 
+                                   const AssocFilletLineBatchOutput& output, 
+                                   int                               k, 
+                                   const AcGeTol&                    tol)
+{
+    AcGeLineSeg3d line[2];
+    AcGeCurve3d*  curve[2] = { &line[0], &line[1], };
+    bool          isTrimCurve[2];
+    bool          isIncoming[2];
+    for (int i = 0; i < 2; i++)
+    {
+        line[i].set(AcGePoint3d(input.mStartX[i][k], input.mStartY[i][k], 0.0), 
+                    AcGePoint3d(input.mEndX  [i][k], input.mEndY  [i][k], 0.0));
+        isTrimCurve[i] = input.mIsTrimCurve[i][k];
+        isIncoming [i] = input.mIsIncoming [i][k];
+    }
+
+    AssocFilletConfig config;
+    config.setConfiguration(isIncoming, input.mIntersCrossingType[k]);
+    AcGeCircArc3d filletArc;
+    const bool isValid = config.evaluate(false, curve, input.mRadius[k], isTrimCurve, false, filletArc, tol) == Acad::eOk;
+    if (isValid != output.mIsValid[k])
+        return false;
+    if (!isValid)
+        return true;
+
+    // The arc may go either way around its normal, so its end points are compared
+    // with the points of tangency in either order
+    //
+    const AcGePoint3d tangent[2] = { AcGePoint3d(output.mTangentX[0][k], output.mTangentY[0][k], 0.0), 
+                                     AcGePoint3d(output.mTangentX[1][k], output.mTangentY[1][k], 0.0), };
+    const AcGePoint3d arcStart   = filletArc.startPoint();
+    const AcGePoint3d arcEnd     = filletArc.endPoint();
+    bool isSame = isSamePoint(filletArc.center().x, filletArc.center().y, output.mCenterX[k], output.mCenterY[k], tol) &&
+                  (arcStart.isEqualTo(tangent[0], tol) && arcEnd.isEqualTo(tangent[1], tol) ||
+                   arcStart.isEqualTo(tangent[1], tol) && arcEnd.isEqualTo(tangent[0], tol));
+    for (int i = 0; i < 2; i++)
+    {
+        isSame = isSame &&
+                 isSamePoint(line[i].startPoint().x, line[i].startPoint().y, output.mTrimmedStartX[i][k], output.mTrimmedStartY[i][k], tol) &&
+                 isSamePoint(line[i].endPoint().x,   line[i].endPoint().y,   output.mTrimmedEndX[i][k],   output.mTrimmedEndY[i][k],   tol);
+    }
+    return isSame;
+}
+
+
+int AssocFilletLineBatch::verify(const AssocFilletLineBatchInput& input, const AcGeTol& tol)
+{
+    const int numFillets = input.mNumFillets;
+
+    LineBatchOutputBuffer scalarBuffer(numFillets);
+    LineBatchOutputBuffer simdBuffer  (numFillets);
+    evaluate(input, scalarBuffer.output(), false, tol);
+    evaluate(input, simdBuffer.output(),   true,  tol);
+
+    int numDifferent = 0;
+    for (int k = 0; k < numFillets; k++)
+    {
+        if (!isSameLineFillet(scalarBuffer.output(), simdBuffer.output(), k, tol) ||
+            !isSameAsConfigEvaluate(input, scalarBuffer.output(), k, tol))
+        {
+            numDifferent++;
+        }
+    }
+    return numDifferent;
+}
+
+
+// Owns the arrays of an AssocFilletLineBatchInput of random fillets, used by
+// runVerificationTest()
+//
+class LineBatchRandomInput
+{
+public:
+    LineBatchRandomInput(int numFillets, unsigned seed);
+    ~LineBatchRandomInput() { delete [] mFlags; }
+
+    const AssocFilletLineBatchInput& input() const { return mInput; }
+
+private:
+    LineBatchRandomInput(const LineBatchRandomInput&);            // Not copyable
+    LineBatchRandomInput& operator=(const LineBatchRandomInput&);
+
+    enum { kNumDoubleArrays = 9, kNumFlagArrays = 4 };
+
+    std::vector<double>       mValues;
+    std::vector<int>          mIntersCrossingType;
+    bool*                     mFlags;
+    AssocFilletLineBatchInput mInput;
+};
+
+
+LineBatchRandomInput::LineBatchRandomInput(int numFillets, unsigned seed)
+  : mValues(kNumDoubleArrays * (numFillets + 1)), mIntersCrossingType(numFillets + 1), mFlags(new bool[kNumFlagArrays * (numFillets + 1)])
+{
+    std::mt19937                           random(seed);
+    std::uniform_real_distribution<double> unit(-1.0, 1.0);
+    std::uniform_int_distribution<int>     bit(0, 1);
+
+    double* pNext = &mValues[0];
+    double* arrays[kNumDoubleArrays];
+    for (int i = 0; i < kNumDoubleArrays; i++)
+    {
+        arrays[i] = pNext;
+        pNext    += numFillets + 1;
+    }
+    bool* flags[kNumFlagArrays];
+    for (int i = 0; i < kNumFlagArrays; i++)
+    {
+        flags[i] = mFlags + i * (numFillets + 1);
+    }
+
+    // Every 16th fillet has lines in opposite directions, which have no fillet.
+    // Their coordinates are multiples of 1/1024 and the directions are multiples
+    // of (3, 4), so that the lines are parallel also after rounding
+    //
+    for (int k = 0; k < numFillets; k++)
+    {
+        const bool isParallel = k % 16 == 15;
+        for (int i = 0; i < 2; i++)
+        {
+            double x = 5.0 * unit(random), y = 5.0 * unit(random), dx, dy;
+            if (isParallel)
+            {
+                x  = floor(x * 1024.0) / 1024.0;
+                y  = floor(y * 1024.0) / 1024.0;
+                dx = (i == 0 ? 3.0 : -3.0) * (1 + k % 3);
+                dy = (i == 0 ? 4.0 : -4.0) * (1 + k % 3);
+            }
+            else
+            {
+                const double angle = M_PI * unit(random), length = 1.0 + 9.0 * (unit(random) + 1.0);
+                dx = length * cos(angle);
+                dy = length * sin(angle);
+            }
+            arrays[4*i + 0][k] = x;
+            arrays[4*i + 1][k] = y;
+            arrays[4*i + 2][k] = x + dx;
+            arrays[4*i + 3][k] = y + dy;
+            flags[i    ][k]    = bit(random) != 0;
+            flags[i + 2][k]    = bit(random) != 0;
+        }
+        arrays[8][k]           = 0.1 + 0.9 * (unit(random) + 1.0);
+        mIntersCrossingType[k] = bit(random);
+    }
+
+    mInput.mNumFillets         = numFillets;
+    mInput.mIntersCrossingType = &mIntersCrossingType[0];
+    mInput.mRadius             = arrays[8];
+    for (int i = 0; i < 2; i++)
+    {
+        mInput.mStartX[i]      = arrays[4*i + 0];
+        mInput.mStartY[i]      = arrays[4*i + 1];
+        mInput.mEndX[i]        = arrays[4*i + 2];
+        mInput.mEndY[i]        = arrays[4*i + 3];
+        mInput.mIsIncoming[i]  = flags[i];
+        mInput.mIsTrimCurve[i] = flags[i + 2];
+    }
+}
+
+
+int AssocFilletLineBatch::runVerificationTest(int numFillets, const AcGeTol& tol)
+{
+    const LineBatchRandomInput randomInput(numFillets, 1);
+    return verify(randomInput.input(), tol);
+}
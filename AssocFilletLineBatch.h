@@ -0,0 +1,104 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  Copyright 2014 Autodesk, Inc.  All rights reserved.
+//
+//  Use of this software is subject to the terms of the Autodesk license 
+//  agreement provided at the time of installation or download, or which 
+//  otherwise accompanies this software in either electronic or hard copy form.   
+//
+// DESCRIPTION:
+//
+// This file contains declaration of AssocFilletLineBatch class that computes
+// fillets between pairs of line segments in bulk, without going through
+// AssocFilletConfig::evaluate() for each fillet.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "AssocFilletConfig.h"
+#pragma pack (push, 8)
+
+
+// Input of a batch of fillets between two line segments lying in the XY plane.
+// Each array has numFillets elements, index 0 of the [2] arrays is for the
+// first line and index 1 for the second line of the fillets.
+//
+// The mIsIncoming and mIntersCrossingType are the configuration of each fillet
+// as kept by AssocFilletConfig. The curve normal of two lines is the cross product
+// of their directions, relative to which the first line always crosses the second
+// one from left to right, therefore fillets with mIntersCrossingType == 0 fail the
+// same way they fail in AssocFilletConfig::evaluate()
+//
+struct AssocFilletLineBatchInput
+{
+    int           mNumFillets;
+    const double* mStartX[2];
+    const double* mStartY[2];
+    const double* mEndX[2];
+    const double* mEndY[2];
+    const double* mRadius;
+    const bool*   mIsIncoming[2];
+    const int*    mIntersCrossingType;
+    const bool*   mIsTrimCurve[2];
+};
+
+
+// Output of a batch of fillets, each array has mNumFillets elements of the input.
+// The fillet arc angles are measured counterclockwise around the Z axis from the
+// X axis, like the angles of an AcDbArc in the XY plane of WCS. The trimmed lines
+// are the input lines if they are not to be trimmed. The results of the fillets
+// that are not valid are undefined
+//
+struct AssocFilletLineBatchOutput
+{
+    double* mCenterX;
+    double* mCenterY;
+    double* mStartAngle;
+    double* mEndAngle;
+    double* mTangentX[2];     // Points of tangency of each line with the fillet arc
+    double* mTangentY[2];
+    double* mParam[2];        // Parameters of the points of tangency on the lines
+    double* mTrimmedStartX[2];
+    double* mTrimmedStartY[2];
+    double* mTrimmedEndX[2];
+    double* mTrimmedEndY[2];
+    bool*   mIsValid;         // The fillet could be computed and the lines trimmed
+};
+
+
+// The line/line fillets are computed in closed form, four fillets at a time
+// using AVX instructions if the processor supports AVX2, otherwise one after
+// another. Both ways give the same results as AssocFilletConfig::evaluate()
+// does for the same lines, radius and configuration, within the tolerance,
+// which verify() checks for a given batch
+//
+class AssocFilletLineBatch
+{
+public:
+    // Returns the number of valid fillets. If allowSimd is false, the scalar
+    // code is used even if the processor supports AVX2
+    //
+    static int evaluate(const AssocFilletLineBatchInput& input,
+                        AssocFilletLineBatchOutput&      output,
+                        bool                             allowSimd = true,
+                        const AcGeTol&                   tol = AssocFilletConfig::geomTolerance());
+
+    static bool isSimdSupported();
+
+    // Evaluates the batch with and without AVX, and each fillet also by 
+    // AssocFilletConfig::evaluate() on AcGeLineSeg3d copies of the lines. Returns 
+    // the number of fillets whose validity differs, or whose fillet arc center,
+    // arc end points or trimmed lines are farther apart than tol.equalPoint().
+    // It is meant for testing, and it is much slower than evaluate()
+    //
+    static int verify(const AssocFilletLineBatchInput& input,
+                      const AcGeTol&                   tol = AssocFilletConfig::geomTolerance());
+
+    // Runs verify() on a batch of numFillets random fillets generated from a 
+    // fixed seed, with random configurations, trim flags and some parallel lines
+    //
+    static int runVerificationTest(int            numFillets,
+                                   const AcGeTol& tol = AssocFilletConfig::geomTolerance());
+};
+
+#pragma pack (pop)
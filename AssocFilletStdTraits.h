@@ -0,0 +1,101 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  Copyright 2014 Autodesk, Inc.  All rights reserved.
+//
+//  Use of this software is subject to the terms of the Autodesk license 
+//  agreement provided at the time of installation or download, or which 
+//  otherwise accompanies this software in either electronic or hard copy form.   
+//
+// DESCRIPTION:
+//
+// This file contains the traits class that adapts the geometry core in 
+// AssocFilletGeometry.h to plain C++ points and vectors. It does not depend 
+// on ObjectARX, so that the fillet math can be built and profiled on any 
+// platform.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "AssocFilletGeometry.h"
+#pragma pack (push, 8)
+
+
+struct FilletPoint3d
+{
+    double x, y, z;
+};
+
+
+struct FilletVector3d
+{
+    double x, y, z;
+};
+
+
+// Same meaning as AcGe::AcGeXConfig
+//
+enum FilletCrossingConfig
+{
+    kFilletNotDefined,
+    kFilletLeftRight,
+    kFilletRightLeft,
+    kFilletLeftLeft,
+    kFilletRightRight
+};
+
+
+struct FilletStdTraits
+{
+    typedef FilletPoint3d        Point;
+    typedef FilletVector3d       Vector;
+    typedef FilletCrossingConfig Config;
+
+    static Vector difference(const Point& p, const Point& q)
+    {
+        const Vector v = { p.x - q.x, p.y - q.y, p.z - q.z, };
+        return v;
+    }
+
+    static Point translate(const Point& p, const Vector& v)
+    {
+        const Point q = { p.x + v.x, p.y + v.y, p.z + v.z, };
+        return q;
+    }
+
+    static Vector add(const Vector& u, const Vector& v)
+    {
+        const Vector w = { u.x + v.x, u.y + v.y, u.z + v.z, };
+        return w;
+    }
+
+    static Vector scale(double s, const Vector& v)
+    {
+        const Vector w = { s * v.x, s * v.y, s * v.z, };
+        return w;
+    }
+
+    static double dot(const Vector& u, const Vector& v)
+    {
+        return u.x * v.x + u.y * v.y + u.z * v.z;
+    }
+
+    static Vector cross(const Vector& u, const Vector& v)
+    {
+        const Vector w = { u.y * v.z - u.z * v.y, u.z * v.x - u.x * v.z, u.x * v.y - u.y * v.x, };
+        return w;
+    }
+
+    static int crossingType(const Config& config)
+    {
+        switch (config)
+        {
+        case kFilletLeftRight:  return 1;
+        case kFilletRightLeft:  return 0;
+        case kFilletLeftLeft:   
+        case kFilletRightRight: return -1;
+        default:                return -2;
+        }
+    }
+};
+
+#pragma pack (pop)
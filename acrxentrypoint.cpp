@@ -15,8 +15,10 @@
 #include "StdAfx.h"
 #include "arxEntryPoint.h"
 #include "AssocFilletActionBody.h"
+#include "AssocFilletArcIndex.h"
 
 void assocFilletCommandUI();
+void assocFilletTestCommandUI();
     
 
 class AssocFilletSampleApp : public AcRxArxApp 
@@ -26,6 +28,7 @@ public:
     {
         const AcRx::AppRetCode retCode = AcRxArxApp::On_kInitAppMsg(pkt);
         acedRegCmds->addCommand(L"ASSOCFILLETSAMPLE", L"ASSOCFILLET", L"ASSOCFILLET", ACRX_CMD_MODAL, assocFilletCommandUI);
+        acedRegCmds->addCommand(L"ASSOCFILLETSAMPLE", L"ASSOCFILLETTEST", L"ASSOCFILLETTEST", ACRX_CMD_MODAL, assocFilletTestCommandUI);
         AssocFilletActionBody::rxInit();
         acrxBuildClassHierarchy();
         return retCode;
@@ -34,6 +37,9 @@ public:
     virtual AcRx::AppRetCode On_kUnloadAppMsg(void* pkt) override
     {
         const AcRx::AppRetCode retCode = AcRxArxApp::On_kUnloadAppMsg(pkt);
+        AssocFilletConfig::setIntersectionThreadCount(1);
+        AssocFilletConfig::clearOffsetCurveCache();
+        AssocFilletArcIndex::clear();
         deleteAcRxClass(AssocFilletActionBody::desc());
         acrxBuildClassHierarchy();
         acedRegCmds->removeGroup(L"ASSOCFILLETSAMPLE");